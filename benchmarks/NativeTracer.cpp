@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/Tracer.hpp"
+
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace dpcpp_trace;
+
+constexpr int kNumOpens = 1000;
+
+// Length of the file name is the benchmark argument, paths are copied from
+// and to the tracee on every intercepted call.
+static fs::path makeTestFile(const benchmark::State &state) {
+  fs::path path = fs::temp_directory_path() /
+                  std::string(static_cast<size_t>(state.range(0)), 'o');
+  std::ofstream{path};
+  return path;
+}
+
+static void openFiles(const fs::path &path) {
+  for (int i = 0; i < kNumOpens; i++) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd != -1)
+      close(fd);
+  }
+}
+
+static void setPerOpenCounter(benchmark::State &state) {
+  state.counters["per_open"] =
+      benchmark::Counter(static_cast<double>(state.iterations() * kNumOpens),
+                         benchmark::Counter::kIsRate |
+                             benchmark::Counter::kInvert);
+}
+
+static void openNative(benchmark::State &state) {
+  const fs::path path = makeTestFile(state);
+  for (auto _ : state) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      openFiles(path);
+      _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+  }
+  setPerOpenCounter(state);
+  fs::remove(path);
+}
+
+BENCHMARK(openNative)->Arg(8)->Arg(64)->Arg(240)->UseRealTime();
+
+static void openTraced(benchmark::State &state) {
+  const fs::path path = makeTestFile(state);
+  for (auto _ : state) {
+    NativeTracer tracer;
+    tracer.onFileOpen([](std::string_view filename, const OpenHandler &) {
+      benchmark::DoNotOptimize(filename.data());
+    });
+    tracer.fork([&path] { openFiles(path); });
+    tracer.start();
+    tracer.wait();
+  }
+  setPerOpenCounter(state);
+  fs::remove(path);
+}
+
+BENCHMARK(openTraced)->Arg(8)->Arg(64)->Arg(240)->UseRealTime();
+
+static void openTracedReplace(benchmark::State &state) {
+  const fs::path path = makeTestFile(state);
+  for (auto _ : state) {
+    NativeTracer tracer;
+    tracer.onFileOpen([&path](std::string_view, const OpenHandler &handler) {
+      handler.replaceFilename(path.string());
+    });
+    tracer.fork([&path] { openFiles(path); });
+    tracer.start();
+    tracer.wait();
+  }
+  setPerOpenCounter(state);
+  fs::remove(path);
+}
+
+BENCHMARK(openTracedReplace)->Arg(8)->Arg(64)->Arg(240)->UseRealTime();
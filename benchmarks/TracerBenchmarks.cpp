@@ -0,0 +1,153 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/Tracer.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <spawn.h>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace dpcpp_trace;
+
+// Startup latency and per-call overhead of tracers for a whole application.
+// The argument is the number of openat and stat pairs, that the workload
+// makes, so runs with 0 calls measure startup alone. Traced runs also report
+// the difference to an untraced run of the same workload.
+
+constexpr auto kWorkloadFileName = "tracer_benchmark_file";
+constexpr auto kMissingFileName = "tracer_benchmark_missing";
+constexpr int kNumBaselineRuns = 5;
+
+static fs::path getWorkloadFile() {
+  fs::path path = fs::temp_directory_path() / kWorkloadFileName;
+  if (!fs::exists(path))
+    std::ofstream{path} << 42;
+  return path;
+}
+
+static std::vector<std::string> getWorkloadArgs(int64_t numCalls,
+                                                const fs::path &file) {
+  return {DPCPP_TRACE_TRACER_WORKLOAD, std::to_string(numCalls),
+          file.string()};
+}
+
+static void runUntraced(std::vector<std::string> &args) {
+  std::vector<char *> cArgs;
+  for (std::string &arg : args)
+    cArgs.push_back(arg.data());
+  cArgs.push_back(nullptr);
+  char *env[] = {nullptr};
+
+  pid_t pid;
+  if (posix_spawn(&pid, cArgs[0], nullptr, nullptr, cArgs.data(), env) != 0)
+    throw std::runtime_error("Failed to launch workload");
+  waitpid(pid, nullptr, 0);
+}
+
+// Untraced time of one run in nanoseconds.
+static double measureBaseline(int64_t numCalls) {
+  std::vector<std::string> args = getWorkloadArgs(numCalls, getWorkloadFile());
+  runUntraced(args);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumBaselineRuns; i++)
+    runUntraced(args);
+  const std::chrono::duration<double, std::nano> time =
+      std::chrono::steady_clock::now() - start;
+  return time.count() / kNumBaselineRuns;
+}
+
+static void setCounters(benchmark::State &state, double tracedNs,
+                        double baselineNs) {
+  const double numCalls = 2.0 * static_cast<double>(state.range(0));
+  const double overheadNs = tracedNs - baselineNs;
+  state.counters["overhead_us"] = overheadNs / 1000;
+  if (numCalls == 0)
+    return;
+  state.counters["per_call"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) * numCalls,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["overhead_ns_per_call"] = overheadNs / numCalls;
+}
+
+static void workloadUntraced(benchmark::State &state) {
+  std::vector<std::string> args =
+      getWorkloadArgs(state.range(0), getWorkloadFile());
+  for (auto _ : state)
+    runUntraced(args);
+
+  if (state.range(0) != 0)
+    state.counters["per_call"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * state.range(0) * 2),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(workloadUntraced)->Arg(0)->Arg(1000)->Arg(10000)->UseRealTime();
+
+// With redirect, the workload probes a missing file, that the tracer replaces
+// with an existing one, like replay does.
+static void workloadTraced(benchmark::State &state, TracerKind kind,
+                           bool redirect) {
+  const fs::path file = getWorkloadFile();
+  const fs::path probed =
+      redirect ? fs::temp_directory_path() / kMissingFileName : file;
+  std::vector<std::string> args = getWorkloadArgs(state.range(0), probed);
+  std::vector<std::string> env;
+  const double baselineNs = measureBaseline(state.range(0));
+
+  double tracedNs = 0;
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Tracer> tracer = makeTracer(kind);
+    tracer->onFileOpen([&](std::string_view filename, const OpenHandler &h) {
+      benchmark::DoNotOptimize(filename.data());
+      if (redirect && filename == probed.string())
+        h.replaceFilename(file.string());
+    });
+    tracer->onStat([&](std::string_view filename, const StatHandler &h) {
+      benchmark::DoNotOptimize(filename.data());
+      if (redirect && filename == probed.string())
+        h.replaceFilename(file.string());
+    });
+
+    try {
+      tracer->launch(args[0], args, env);
+    } catch (const std::exception &e) {
+      // Seccomp user notifications are not supported by every kernel.
+      state.SkipWithError(e.what());
+      return;
+    }
+    tracer->start();
+    tracer->wait();
+    const std::chrono::duration<double, std::nano> time =
+        std::chrono::steady_clock::now() - start;
+    tracedNs += time.count();
+  }
+
+  setCounters(state, tracedNs / static_cast<double>(state.iterations()),
+              baselineNs);
+}
+
+BENCHMARK_CAPTURE(workloadTraced, native, TracerKind::Native, false)
+    ->Arg(0)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(workloadTraced, native_redirect, TracerKind::Native, true)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(workloadTraced, seccomp, TracerKind::Seccomp, false)
+    ->Arg(0)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(workloadTraced, seccomp_redirect, TracerKind::Seccomp, true)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime();
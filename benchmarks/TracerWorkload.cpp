@@ -0,0 +1,21 @@
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Synthetic application of TracerBenchmarks, makes argv[1] openat and stat
+// calls of the file argv[2] each.
+int main(int argc, char *argv[]) {
+  if (argc != 3)
+    return EXIT_FAILURE;
+
+  const long numCalls = std::strtol(argv[1], nullptr, 10);
+  for (long i = 0; i < numCalls; i++) {
+    const int fd = openat(AT_FDCWD, argv[2], O_RDONLY | O_CLOEXEC);
+    if (fd != -1)
+      close(fd);
+    struct stat st;
+    stat(argv[2], &st);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <CL/sycl/detail/pi.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Describes arguments of PI functions, that are written by the call. The record
+// plugin saves them as small outputs and the replay plugin restores them, so
+// that any function from pi.def can be replayed without a hand-written
+// handler.
+//
+// Pointers to a single handle (pi_context *, pi_event *, ...) are always
+// outputs, saved as 64-bit values in the order of arguments, and need no
+// description. Input arrays of handles are const-qualified.
+struct ApiDescriptor {
+  // Layout of info queries. Answers are keyed by the first argument, the
+  // optional sub-object (e.g. device of piKernelGetGroupInfo) and param.
+  struct InfoQuery {
+    int param = -1;
+    int subObject = -1;
+    int valueSize = -1;
+    int value = -1;
+    int retSize = -1;
+  };
+
+  // Pointer to a single value written by the call, e.g. num_devices_ret.
+  int scalarOutput = -1;
+  // Array of handles written by the call and the argument with its length.
+  int handleArray = -1;
+  int handleArraySize = -1;
+  // Pointer to USM allocation result and the argument with its size.
+  int allocPtr = -1;
+  int allocSize = -1;
+  InfoQuery info;
+};
+
+constexpr ApiDescriptor::InfoQuery infoQuery(int param, int subObject = -1) {
+  return {param, subObject, param + 1, param + 2, param + 3};
+}
+
+// piPlatformsGet, piDevicesGet, piextDeviceSelectBinary and functions, that
+// transfer memory to the host, have dedicated handlers on both sides.
+constexpr ApiDescriptor getApiDescriptor(sycl::detail::PiApiKind kind) {
+  using sycl::detail::PiApiKind;
+
+  ApiDescriptor desc;
+  switch (kind) {
+  case PiApiKind::piPlatformGetInfo:
+  case PiApiKind::piDeviceGetInfo:
+  case PiApiKind::piContextGetInfo:
+  case PiApiKind::piQueueGetInfo:
+  case PiApiKind::piMemGetInfo:
+  case PiApiKind::piMemImageGetInfo:
+  case PiApiKind::piProgramGetInfo:
+  case PiApiKind::piKernelGetInfo:
+  case PiApiKind::piEventGetInfo:
+  case PiApiKind::piEventGetProfilingInfo:
+  case PiApiKind::piSamplerGetInfo:
+    desc.info = infoQuery(1);
+    break;
+  case PiApiKind::piKernelGetGroupInfo:
+  case PiApiKind::piProgramGetBuildInfo:
+  case PiApiKind::piextUSMGetMemAllocInfo:
+    desc.info = infoQuery(2, 1);
+    break;
+  case PiApiKind::piKernelGetSubGroupInfo:
+    // Input value of the query precedes the output.
+    desc.info = {2, 1, 5, 6, 7};
+    break;
+  case PiApiKind::piDevicePartition:
+    desc.scalarOutput = 4;
+    desc.handleArray = 3;
+    desc.handleArraySize = 2;
+    break;
+  case PiApiKind::piextGetDeviceFunctionPointer:
+    desc.scalarOutput = 3;
+    break;
+  case PiApiKind::piextPlatformGetNativeHandle:
+  case PiApiKind::piextDeviceGetNativeHandle:
+  case PiApiKind::piextContextGetNativeHandle:
+  case PiApiKind::piextQueueGetNativeHandle:
+  case PiApiKind::piextMemGetNativeHandle:
+  case PiApiKind::piextProgramGetNativeHandle:
+  case PiApiKind::piextKernelGetNativeHandle:
+  case PiApiKind::piextEventGetNativeHandle:
+    desc.scalarOutput = 1;
+    break;
+  case PiApiKind::piextUSMHostAlloc:
+    desc.allocPtr = 0;
+    desc.allocSize = 3;
+    break;
+  case PiApiKind::piextUSMDeviceAlloc:
+  case PiApiKind::piextUSMSharedAlloc:
+    desc.allocPtr = 0;
+    desc.allocSize = 4;
+    break;
+  default:
+    break;
+  }
+  return desc;
+}
+
+inline bool isInfoQuery(uint32_t funcId) {
+  return getApiDescriptor(static_cast<sycl::detail::PiApiKind>(funcId))
+             .info.param >= 0;
+}
+
+template <typename T>
+inline constexpr bool isPiHandle =
+    std::is_same_v<T, pi_platform> || std::is_same_v<T, pi_device> ||
+    std::is_same_v<T, pi_context> || std::is_same_v<T, pi_queue> ||
+    std::is_same_v<T, pi_mem> || std::is_same_v<T, pi_program> ||
+    std::is_same_v<T, pi_kernel> || std::is_same_v<T, pi_event> ||
+    std::is_same_v<T, pi_sampler>;
+
+template <typename T> inline constexpr bool isHandleOutput = false;
+template <typename T> inline constexpr bool isHandleOutput<T *> = isPiHandle<T>;
+
+// Pointer to a single value, that is not a handle, e.g. pi_uint32 *.
+template <typename T> inline constexpr bool isScalarOutput = false;
+template <typename T>
+inline constexpr bool isScalarOutput<T *> =
+    !isPiHandle<T> && !std::is_const_v<T> &&
+    (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>);
+
+template <typename T>
+struct IsScalarOutput : std::bool_constant<isScalarOutput<T>> {};
+template <typename T>
+struct IsHandleOutput : std::bool_constant<isHandleOutput<T>> {};
+template <typename T> struct IsAllocOutput : std::is_same<T, void **> {};
+template <typename T> struct IsSizeOutput : std::is_same<T, size_t *> {};
+
+// Checks, that idx-th argument type satisfies Pred, used to validate
+// descriptors against function signatures at compile time.
+template <template <typename> typename Pred, typename... Ts>
+constexpr bool argSatisfies(int idx) {
+  int i = 0;
+  bool res = false;
+  ((res |= (i++ == idx && Pred<Ts>::value)), ...);
+  return res;
+}
@@ -1,15 +1,34 @@
 #pragma once
 
+#include <cstddef>
+
 inline constexpr auto kSkipMemObjsEnvVar = "DPCPP_TRACE_SKIP_MEM_OBJECTS";
+inline constexpr auto kElideInfoQueriesEnvVar =
+    "DPCPP_TRACE_ELIDE_INFO_QUERIES";
 inline constexpr auto kTracePathEnvVar = "DPCPP_TRACE_DATA_PATH";
+// "<process id> <name>" of the main thread of the process, that set it, so
+// that libsystem_intercept keeps names of processes across exec.
+inline constexpr auto kProcessNameEnvVar = "DPCPP_TRACE_PROCESS_NAME";
 inline constexpr auto kPIDebugStreamName = "sycl.pi.debug";
 
 inline constexpr auto kFilesConfigName = "files_config.json";
+inline constexpr auto kFileAccessLogName = "files.bin";
+// Per-file host I/O of record --io-profile and the steady clock time in
+// nanoseconds, that PI call times of the trace are relative to.
+inline constexpr auto kIOProfileName = "io_profile.json";
+inline constexpr auto kRecordStartTimeName = "start_time";
 inline constexpr auto kPackedDataPath = "pack";
 
 inline constexpr auto kBuffersPath = "buffers";
 
 inline constexpr auto kPiTraceExt = ".pi_trace";
+// Lines of "<thread name> <process id> <thread id>" of threads, that recorded
+// PI traces.
+inline constexpr auto kThreadTableName = "threads.txt";
+
+// zstd compression level of packed traces
+inline constexpr int kDefaultCompressionLevel = 3;
+inline constexpr int kMaxCompressionLevel = 22;
 
 // Replay config constants
 inline constexpr auto kReplayConfigName = "replay_config.json";
@@ -23,6 +42,7 @@ inline constexpr auto kRecordMode = "recordMode";
 inline constexpr auto kRecordModeTraceOnly = "traceOnly";
 inline constexpr auto kRecordModeDefault = "default";
 inline constexpr auto kRecordModeFull = "full";
+inline constexpr auto kRecordElideInfoQueries = "elideInfoQueries";
 
 inline constexpr auto kHasOpenCLPlugin = "hasOpenCLPlugin";
 inline constexpr auto kHasLevelZeroPlugin = "hasLevelZeroPlugin";
@@ -33,3 +53,23 @@ inline constexpr auto kOpenCLPluginName = "libpi_opencl.so";
 inline constexpr auto kLevelZeroPluginName = "libpi_level_zero.so";
 inline constexpr auto kCUDAPluginName = "libpi_cuda.so";
 inline constexpr auto kROCmPluginName = "libpi_rocm.so";
+
+// Replay benchmark constants
+inline constexpr auto kReplayBenchEnvVar = "DPCPP_TRACE_REPLAY_BENCH";
+inline constexpr auto kReplayFastEnvVar = "DPCPP_TRACE_REPLAY_FAST";
+inline constexpr auto kReplayBenchExt = ".bench";
+
+// Resynchronize with the trace instead of failing on unexpected PI calls
+inline constexpr auto kReplayTolerantEnvVar = "DPCPP_TRACE_REPLAY_TOLERANT";
+
+// Number of records decoded ahead of the replaying thread
+inline constexpr auto kReplayLookaheadEnvVar = "DPCPP_TRACE_REPLAY_LOOKAHEAD";
+inline constexpr size_t kReplayDefaultLookahead = 16;
+
+// Size limit of files extracted on demand when replaying from an archive, MiB
+inline constexpr size_t kReplayDefaultCacheSize = 1024;
+
+// In-process redirection of packed files, see libsystem_redirect
+inline constexpr auto kRedirectTableEnvVar = "DPCPP_TRACE_REDIRECT_TABLE";
+inline constexpr auto kRedirectTableName = "redirect_table.bin";
+inline constexpr auto kRedirectLibsPath = "redirect_libs";
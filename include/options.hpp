@@ -1,5 +1,10 @@
 #pragma once
 
+#include "constants.hpp"
+#include "utils/Tracer.hpp"
+
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <string_view>
@@ -37,10 +42,57 @@ public:
 
   bool record_override_trace() const noexcept { return mRecordOverrideTrace; }
 
+  bool record_elide_info_queries() const noexcept {
+    return mRecordElideInfoQueries;
+  }
+
+  // Record time and bytes of I/O calls on opened files.
+  bool record_io_profile() const noexcept { return mRecordIOProfile; }
+
   bool no_fork() const noexcept { return mNoFork; }
 
+  // Backend, that intercepts file accesses of record and replay.
+  dpcpp_trace::TracerKind tracer() const noexcept { return mTracer; }
+
+  // Time limit of the application in record and replay, 0 means no limit.
+  std::chrono::seconds timeout() const noexcept { return mTimeout; }
+
   bool print_only() const noexcept { return mPrintOnly; }
 
+  // Number of worker threads, 0 means all available cores.
+  size_t jobs() const noexcept { return mJobs; }
+
+  int compression_level() const noexcept { return mCompressionLevel; }
+
+  bool pack_dictionary() const noexcept { return mPackDictionary; }
+
+  // Archive, that unchanged files are copied from without recompression.
+  std::filesystem::path pack_base() const noexcept { return mPackBase; }
+
+  // Glob patterns of archive paths to extract, empty means everything.
+  const std::vector<std::string> &unpack_only() const noexcept {
+    return mUnpackOnly;
+  }
+
+  bool replay_tolerant() const noexcept { return mReplayTolerant; }
+
+  bool replay_in_process() const noexcept { return mReplayInProcess; }
+
+  bool replay_bench() const noexcept { return mReplayBench; }
+
+  size_t replay_bench_iterations() const noexcept {
+    return mReplayBenchIterations;
+  }
+
+  std::filesystem::path replay_bench_output() const noexcept {
+    return mReplayBenchOutput;
+  }
+
+  // Size limit of files extracted from archives, in bytes.
+  uint64_t replay_cache_size() const noexcept {
+    return mReplayCacheSize * 1024 * 1024;
+  }
+
 private:
   void parseRecordOptions(int argc, char *argv[]);
   void parseReplayOptions(int argc, char *argv[]);
@@ -60,8 +112,23 @@ private:
   std::vector<std::string_view> mEnvVars;
   bool mRecordSkipMemObjs = false;
   bool mRecordOverrideTrace = false;
+  bool mRecordElideInfoQueries = false;
+  bool mRecordIOProfile = false;
   bool mNoFork = false;
+  dpcpp_trace::TracerKind mTracer = dpcpp_trace::TracerKind::Native;
+  std::chrono::seconds mTimeout{0};
   bool mPrintOnly = false;
+  bool mReplayTolerant = false;
+  bool mReplayInProcess = false;
+  bool mReplayBench = false;
+  size_t mReplayBenchIterations = 1;
+  std::filesystem::path mReplayBenchOutput;
+  size_t mReplayCacheSize = kReplayDefaultCacheSize;
+  size_t mJobs = 0;
+  int mCompressionLevel = kDefaultCompressionLevel;
+  bool mPackDictionary = false;
+  std::filesystem::path mPackBase;
+  std::vector<std::string> mUnpackOnly;
   bool mDebugServerOnly = false;
   bool mDebugServerProtocolLog = false;
 };
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <string>
+#include <string_view>
+
+namespace dpcpp_trace {
+using getThreadName_t = const char *(*)();
+
+// Name of the calling thread, that its PI trace and buffers are named after.
+// libsystem_intercept names every thread after its parent at creation, so that
+// the name is the same in record and replay, and keeps it in a thread-local,
+// which also changes in forked processes. Without it, names of the kernel are
+// used, that are limited to 15 characters and are looked up once per thread.
+inline std::string_view getThreadName() {
+  static auto *fn = reinterpret_cast<getThreadName_t>(
+      dlsym(RTLD_DEFAULT, "dpcppTraceGetThreadName"));
+  if (fn)
+    return fn();
+
+  thread_local const std::string name = [] {
+    std::array<char, 16> buf{};
+    pthread_getname_np(pthread_self(), buf.data(), buf.size());
+    return std::string{buf.data()};
+  }();
+  return name;
+}
+} // namespace dpcpp_trace
@@ -6,11 +6,26 @@
 #include <span>
 #include <stdexcept>
 #include <string_view>
+#include <sys/types.h>
+#include <vector>
 
 enum class exit_code { none, success, fail };
 
 std::string which(std::string_view executable);
 
+// Copies contents of a regular file. Extents are shared with the source
+// (reflink) if the file system supports it, otherwise data is copied in the
+// kernel. Throws std::runtime_error on failure.
+void copyFile(const std::filesystem::path &from,
+              const std::filesystem::path &to);
+
+// Returns pid and all its descendants, that are alive.
+std::vector<pid_t> getProcessTree(pid_t pid);
+
+// Files, that are copied into packed reproducers. Pseudo file systems are
+// skipped, and relative paths can not be resolved after the application exits.
+bool isPackableFile(std::string_view path);
+
 template <class To, class From>
 inline typename std::enable_if_t<sizeof(To) == sizeof(From) &&
                                      std::is_trivially_copyable_v<From> &&
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "utils/Compression.hpp"
+#include "utils/MappedFile.hpp"
+#include "utils/MemoryView.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dpcpp_trace {
+// Uncompressed size of frames in v1 and v2 archives.
+inline constexpr uint64_t kArchiveFrameSize = 4 * 1024 * 1024;
+inline constexpr uint8_t kArchiveVersion = 2;
+
+// Read access to packed traces.
+//
+// v0 archives are a flat sequence of entries, every file is a single zstd
+// frame. v1 archives store files as independently compressed frames of
+// kArchiveFrameSize bytes, followed by a central directory and a fixed-size
+// trailer, that points to it. Any file of a v1 archive can be extracted
+// without reading the rest of it. v2 archives additionally have a zstd
+// dictionary in the header, that small files are compressed with.
+class Archive {
+public:
+  // Compressed data range inside the archive.
+  struct Frame {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  struct Entry {
+    std::string path;
+    bool isDirectory = false;
+    // Uncompressed size, XXH64 hash of contents and modification time in
+    // nanoseconds. Unknown (zero) for v0 archives.
+    uint64_t size = 0;
+    uint64_t hash = 0;
+    int64_t mtime = 0;
+    std::vector<Frame> frames;
+  };
+
+  // Throws std::runtime_error if the file is not a valid archive. access
+  // describes the order, in which files are going to be extracted.
+  explicit Archive(
+      const std::filesystem::path &path,
+      MappedFileOptions::Access access = MappedFileOptions::Access::Random);
+
+  Archive(const Archive &) = delete;
+  Archive &operator=(const Archive &) = delete;
+
+  // Checks if path is a packed trace, that can be opened.
+  static bool isArchive(const std::filesystem::path &path);
+
+  uint8_t version() const noexcept { return mVersion; }
+
+  const std::vector<Entry> &entries() const noexcept { return mEntries; }
+
+  // Returns nullptr if there is no entry with such path.
+  const Entry *find(std::string_view path) const;
+
+  // Empty if the archive has no dictionary. Compression objects, that are
+  // passed to extract, must use it.
+  MemoryView<const uint8_t> dictionary() const {
+    return MemoryView<const uint8_t>{mMapping.begin() + mDictionary.offset,
+                                     mDictionary.size};
+  }
+
+  MemoryView<const uint8_t> frameData(const Frame &frame) const {
+    return MemoryView<const uint8_t>{mMapping.begin() + frame.offset,
+                                     frame.size};
+  }
+
+  // Decompresses file contents to out. Throws std::runtime_error if contents
+  // do not match the recorded hash.
+  void extract(const Entry &entry, std::ostream &out, Compression &comp) const;
+
+  // Writes the header of a v2 archive, os must be empty.
+  static void writeHeader(std::ostream &os, const Buffer &dictionary);
+
+  // Writes the central directory and the trailer of a v1 or v2 archive. os
+  // must be positioned right after the last frame.
+  static void writeDirectory(std::ostream &os,
+                             const std::vector<Entry> &entries);
+
+private:
+  void parseV0();
+  void parseV1();
+
+  MappedFile mMapping;
+  uint8_t mVersion;
+  Frame mDictionary{0, 0};
+  std::vector<Entry> mEntries;
+  std::unordered_map<std::string_view, size_t> mIndex;
+};
+} // namespace dpcpp_trace
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "utils/Archive.hpp"
+#include "utils/Compression.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dpcpp_trace {
+// Presents contents of an archive as a directory, files are extracted when
+// they are first requested. Files, that are not pinned, are evicted in least
+// recently used order once their total size exceeds capacity. Processes, that
+// have an evicted file open, keep reading it, since it is only unlinked.
+class ArchiveCache {
+public:
+  ArchiveCache(const Archive &archive, std::filesystem::path root,
+               uint64_t capacity);
+  ~ArchiveCache();
+
+  ArchiveCache(const ArchiveCache &) = delete;
+  ArchiveCache &operator=(const ArchiveCache &) = delete;
+
+  const std::filesystem::path &root() const noexcept { return mRoot; }
+
+  // Extracts an entry of the archive unless it is already present. Returns
+  // absolute path to the file or empty path if there is no such entry.
+  std::filesystem::path extract(std::string_view path, bool pinned = false);
+
+  // Extracts the file, that absolutePath refers to, if it is inside root.
+  void onAccess(std::string_view absolutePath);
+
+  // Total size of files, that can be evicted.
+  uint64_t size() const noexcept { return mSize; }
+
+private:
+  void evict();
+
+  struct CachedFile {
+    std::list<std::string>::iterator lruPos;
+    uint64_t size;
+  };
+
+  const Archive &mArchive;
+  std::filesystem::path mRoot;
+  std::string mRootPrefix;
+  uint64_t mCapacity;
+  uint64_t mSize = 0;
+  Compression mCompression;
+  // Most recently used files are at the front.
+  std::list<std::string> mLRU;
+  std::unordered_map<std::string, CachedFile> mFiles;
+};
+} // namespace dpcpp_trace
@@ -1,33 +1,80 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <memory>
+#include <memory_resource>
 
 namespace dpcpp_trace {
+namespace detail {
+class BufferPoolImpl;
+}
+class BufferPool;
+
+// Contiguous byte storage. Memory of pooled buffers is returned to their pool
+// on destruction instead of being freed.
 class Buffer {
 public:
-  explicit Buffer(size_t size) { mData.resize(size); }
+  // Contents are zero-initialized.
+  explicit Buffer(size_t size);
+
+  // Contents are left uninitialized, for data, that is about to be
+  // overwritten. Memory is taken from pool if one is given.
+  static Buffer uninitialized(size_t size, BufferPool *pool = nullptr);
+
+  ~Buffer();
 
   Buffer(const Buffer &) = delete;
-  Buffer(Buffer &&) = default;
+  Buffer(Buffer &&other) noexcept;
   Buffer &operator=(const Buffer &) = delete;
-  Buffer &operator=(Buffer &&) = default;
+  Buffer &operator=(Buffer &&other) noexcept;
 
-  uint8_t *data() noexcept { return mData.data(); }
-  const uint8_t *data() const noexcept { return mData.data(); }
+  uint8_t *data() noexcept { return mData; }
+  const uint8_t *data() const noexcept { return mData; }
 
   template <typename T> T *as() noexcept {
-    return reinterpret_cast<T *>(mData.data());
+    return reinterpret_cast<T *>(mData);
   }
   template <typename T> const T *as() const noexcept {
-    return reinterpret_cast<const T *>(mData.data());
+    return reinterpret_cast<const T *>(mData);
   }
 
-  size_t size() const noexcept { return mData.size(); }
+  size_t size() const noexcept { return mSize; }
+  size_t capacity() const noexcept { return mCapacity; }
+
+  // New bytes are zero-initialized.
+  void resize(size_t size);
+  // New bytes are left uninitialized.
+  void resizeUninitialized(size_t size);
+
+private:
+  Buffer() = default;
+
+  void grow(size_t capacity);
+  void release() noexcept;
+
+  uint8_t *mData = nullptr;
+  size_t mSize = 0;
+  size_t mCapacity = 0;
+  std::pmr::memory_resource *mResource = std::pmr::new_delete_resource();
+  std::shared_ptr<detail::BufferPoolImpl> mPool;
+};
+
+// Keeps memory of destroyed buffers for reuse, so that loops, that process
+// many buffers of similar size, neither allocate nor zero memory on every
+// iteration. Buffers may outlive the pool and be destroyed on any thread.
+class BufferPool {
+public:
+  explicit BufferPool(
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource(),
+      size_t maxCached = 8);
 
-  void resize(size_t size) { mData.resize(size); }
+  // Contents are left uninitialized.
+  Buffer acquire(size_t size) { return Buffer::uninitialized(size, this); }
 
 private:
-  std::vector<uint8_t> mData;
+  friend class Buffer;
+
+  std::shared_ptr<detail::BufferPoolImpl> mImpl;
 };
 } // namespace dpcpp_trace
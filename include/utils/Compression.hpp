@@ -1,18 +1,23 @@
 #pragma once
 
+#include "constants.hpp"
 #include "utils/Buffer.hpp"
 
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <ranges>
+#include <vector>
 
 namespace dpcpp_trace {
 namespace detail {
 class CompressionImpl;
 }
+// Compression contexts are not thread-safe, use one object per thread.
 class Compression {
 public:
-  Compression();
+  explicit Compression(int level = kDefaultCompressionLevel);
 
   Buffer compress(std::ranges::contiguous_range auto in) {
     return std::move(
@@ -21,16 +26,47 @@ public:
                      sizeof(std::ranges::range_value_t<decltype(in)>)));
   }
 
-  Buffer uncompress(std::ranges::contiguous_range auto in) {
+  // Frame header tells the size of the output, frames of untrusted data must
+  // give maxSize, so that they do not make it allocate arbitrary memory.
+  // Throws if the frame is larger or does not match its header.
+  Buffer uncompress(std::ranges::contiguous_range auto in,
+                    size_t maxSize = std::numeric_limits<size_t>::max()) {
     return std::move(
         uncompress(std::ranges::data(in),
                    std::ranges::size(in) *
-                       sizeof(std::ranges::range_value_t<decltype(in)>)));
+                       sizeof(std::ranges::range_value_t<decltype(in)>),
+                   maxSize));
   }
 
+  // Decompresses a frame into out in fixed-size chunks, so memory usage does
+  // not depend on the size of the frame. Returns the number of bytes written.
+  uint64_t uncompress(std::ranges::contiguous_range auto in,
+                      std::ostream &out) {
+    return uncompress(std::ranges::data(in),
+                      std::ranges::size(in) *
+                          sizeof(std::ranges::range_value_t<decltype(in)>),
+                      out);
+  }
+
+  // Makes following calls use a dictionary, an empty one resets it. Frames,
+  // that were compressed without a dictionary, are still decompressed
+  // correctly.
+  void setDictionary(std::ranges::contiguous_range auto dict) {
+    setDictionary(std::ranges::data(dict),
+                  std::ranges::size(dict) *
+                      sizeof(std::ranges::range_value_t<decltype(dict)>));
+  }
+
+  // Trains a dictionary of at most maxSize bytes for inputs, that are similar
+  // to samples. Returns an empty buffer if there are not enough samples.
+  static Buffer trainDictionary(const std::vector<Buffer> &samples,
+                                size_t maxSize);
+
 private:
   Buffer compress(const void *ptr, size_t size);
-  Buffer uncompress(const void *ptr, size_t size);
+  Buffer uncompress(const void *ptr, size_t size, size_t maxSize);
+  uint64_t uncompress(const void *ptr, size_t size, std::ostream &out);
+  void setDictionary(const void *ptr, size_t size);
 
   std::shared_ptr<detail::CompressionImpl> mImpl;
 };
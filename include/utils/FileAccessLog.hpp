@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dpcpp_trace {
+// Files, that the application opened during record. Applications open the
+// same files many times and probe for libraries in every directory of the
+// search path, so every path is stored once together with the result of its
+// opens and file metadata at record time. pack copies only files, that were
+// opened successfully, without looking them up again.
+struct FileAccess {
+  std::string path;
+  // Union of flags of all opens of the path.
+  int flags = 0;
+  // At least one open succeeded.
+  bool opened = false;
+  // Metadata is only valid for opened files.
+  bool regular = false;
+  uint64_t device = 0;
+  uint64_t inode = 0;
+  uint64_t size = 0;
+  int64_t modificationTimeNs = 0;
+};
+
+// Binary file of a header followed by fixed-size records with paths. Not
+// thread-safe.
+class FileAccessLog {
+public:
+  // Returns the entry of path, it is created on the first access.
+  FileAccess &operator[](std::string_view path);
+
+  size_t size() const noexcept { return mEntries.size(); }
+  const std::deque<FileAccess> &entries() const noexcept { return mEntries; }
+
+  // Throw std::runtime_error on I/O errors or unknown format.
+  void write(const std::filesystem::path &file) const;
+  static std::vector<FileAccess> read(const std::filesystem::path &file);
+
+private:
+  // Elements of a deque are not moved, when new ones are added, so keys point
+  // to paths of the entries.
+  std::deque<FileAccess> mEntries;
+  std::unordered_map<std::string_view, size_t> mIndex;
+};
+} // namespace dpcpp_trace
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+
+namespace dpcpp_trace {
+// Streaming implementation of XXH64 hash, used to verify packed files.
+class XXHash64 {
+public:
+  explicit XXHash64(uint64_t seed = 0);
+
+  void update(const void *ptr, size_t size);
+
+  void update(std::ranges::contiguous_range auto in) {
+    update(std::ranges::data(in),
+           std::ranges::size(in) *
+               sizeof(std::ranges::range_value_t<decltype(in)>));
+  }
+
+  uint64_t digest() const;
+
+private:
+  std::array<uint64_t, 4> mAcc;
+  std::array<uint8_t, 32> mBuffer;
+  size_t mBufferSize = 0;
+  uint64_t mTotalSize = 0;
+  uint64_t mSeed;
+};
+
+inline uint64_t xxh64(std::ranges::contiguous_range auto in) {
+  XXHash64 hash;
+  hash.update(in);
+  return hash.digest();
+}
+} // namespace dpcpp_trace
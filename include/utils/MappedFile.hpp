@@ -1,22 +1,63 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <span>
 
 namespace dpcpp_trace {
+// How a mapping is going to be read. Readers should pick the strategy, that
+// matches their access pattern, so that the kernel does not read ahead
+// useless data or fault in pages one by one.
+struct MappedFileOptions {
+  enum class Access { Normal, Sequential, Random };
+
+  Access access = Access::Normal;
+  // Start reading the whole range in background (MADV_WILLNEED).
+  bool willNeed = false;
+  // Fault in the whole range before the constructor returns (MAP_POPULATE).
+  bool populate = false;
+  // Ask for transparent huge pages (MADV_HUGEPAGE). This is only a hint, it
+  // has effect only if the kernel supports huge pages for files.
+  bool hugePages = false;
+  // Range of the file to map, until the end of file by default.
+  uint64_t offset = 0;
+  std::optional<uint64_t> length;
+};
+
 class MappedFile {
 public:
-  explicit MappedFile(std::filesystem::path path);
+  // Throws std::runtime_error if the file can not be mapped or the range is
+  // outside of the file. Empty ranges are valid and have no mapping.
+  explicit MappedFile(std::filesystem::path path,
+                      const MappedFileOptions &options = MappedFileOptions{});
   ~MappedFile();
 
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
   uint8_t *begin();
   const uint8_t *begin() const;
 
   uint8_t *end();
   const uint8_t *end() const;
 
+  size_t size() const noexcept { return mSize; }
+
+  std::span<const uint8_t> span() const { return {begin(), mSize}; }
+  std::span<const uint8_t> subspan(size_t offset, size_t count) const {
+    return span().subspan(offset, count);
+  }
+
+  // Starts reading part of the mapping in background.
+  void prefetch(size_t offset, size_t count) const;
+
 private:
-  void *mPtr;
-  size_t mSize;
-  int mFileDescriptor;
+  // Mapping starts at a page boundary, that may precede the requested offset.
+  void *mMapping = nullptr;
+  size_t mMappingSize = 0;
+  void *mPtr = nullptr;
+  size_t mSize = 0;
+  int mFileDescriptor = -1;
 };
 } // namespace dpcpp_trace
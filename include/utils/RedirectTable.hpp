@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace dpcpp_trace {
+// Lookup table from original paths of a packed reproducer to their packed
+// copies, relative to the trace directory. It is written by pack and
+// memory-mapped by replay and by libsystem_redirect, which redirects file
+// accesses from within the application, so it is read in place without
+// allocations.
+//
+// The file is a header, two arrays of buckets and zero-terminated strings.
+// Buckets are open addressing hash tables with power of two sizes. The first
+// one is keyed by full paths. The second one is keyed by file names of shared
+// libraries and their shorter versions (libfoo.so.1.2 gives libfoo.so.1 and
+// libfoo.so), for libraries, that are looked up by name.
+namespace redirect_table {
+inline constexpr char kMagic[8] = {'D', 'P', 'C', 'T', 'R', 'D', 'I', 'R'};
+inline constexpr uint32_t kVersion = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t numPaths;
+  uint32_t numLibraries;
+  uint32_t reserved;
+};
+
+// Offsets are relative to the beginning of the file, 0 marks empty buckets.
+struct Bucket {
+  uint64_t hash;
+  uint32_t key;
+  uint32_t keySize;
+  uint32_t value;
+  uint32_t reserved;
+};
+
+// FNV-1a, the table must be readable without any dependencies.
+inline uint64_t hash(std::string_view str) noexcept {
+  uint64_t result = 0xcbf29ce484222325ull;
+  for (char c : str) {
+    result ^= static_cast<uint8_t>(c);
+    result *= 0x100000001b3ull;
+  }
+  return result;
+}
+
+class View {
+public:
+  View() = default;
+  View(const void *data, size_t size)
+      : mData(static_cast<const char *>(data)), mSize(size) {
+    if (mSize < sizeof(Header))
+      return;
+    std::memcpy(&mHeader, mData, sizeof(Header));
+    const uint64_t bucketsSize =
+        (uint64_t{mHeader.numPaths} + mHeader.numLibraries) * sizeof(Bucket);
+    mValid = std::memcmp(mHeader.magic, kMagic, sizeof(kMagic)) == 0 &&
+             mHeader.version == kVersion &&
+             sizeof(Header) + bucketsSize <= mSize;
+  }
+
+  bool valid() const noexcept { return mValid; }
+
+  // Return zero-terminated replacement or nullptr.
+  const char *findPath(std::string_view path) const noexcept {
+    return lookup(0, mHeader.numPaths, path);
+  }
+  const char *findLibrary(std::string_view name) const noexcept {
+    return lookup(mHeader.numPaths, mHeader.numLibraries, name);
+  }
+
+  // Exact path first, then file name for shared libraries, since the dynamic
+  // loader probes several directories, that may not exist on this system.
+  const char *find(std::string_view path) const noexcept {
+    if (const char *replacement = findPath(path))
+      return replacement;
+    if (path.find(".so") == std::string_view::npos)
+      return nullptr;
+    return findLibrary(path.substr(path.rfind('/') + 1));
+  }
+
+  // Calls f(name, replacement) for all library keys.
+  template <typename F> void forEachLibrary(F &&f) const {
+    if (!mValid)
+      return;
+    const auto *buckets =
+        reinterpret_cast<const Bucket *>(mData + sizeof(Header)) +
+        mHeader.numPaths;
+    for (uint32_t i = 0; i < mHeader.numLibraries; i++) {
+      const Bucket &bucket = buckets[i];
+      if (bucket.key == 0 || uint64_t{bucket.key} + bucket.keySize > mSize ||
+          bucket.value >= mSize)
+        continue;
+      f(std::string_view{mData + bucket.key, bucket.keySize},
+        mData + bucket.value);
+    }
+  }
+
+private:
+  const char *lookup(uint32_t first, uint32_t num,
+                     std::string_view key) const noexcept {
+    if (!mValid || num == 0)
+      return nullptr;
+
+    const auto *buckets =
+        reinterpret_cast<const Bucket *>(mData + sizeof(Header)) + first;
+    const uint64_t keyHash = hash(key);
+    for (uint32_t i = 0; i < num; i++) {
+      const Bucket &bucket = buckets[(keyHash + i) & (num - 1)];
+      if (bucket.key == 0)
+        return nullptr;
+      if (bucket.hash == keyHash && bucket.keySize == key.size() &&
+          uint64_t{bucket.key} + bucket.keySize <= mSize &&
+          std::memcmp(mData + bucket.key, key.data(), key.size()) == 0)
+        return bucket.value < mSize ? mData + bucket.value : nullptr;
+    }
+    return nullptr;
+  }
+
+  const char *mData = nullptr;
+  size_t mSize = 0;
+  Header mHeader = {};
+  bool mValid = false;
+};
+} // namespace redirect_table
+
+class RedirectTableBuilder {
+public:
+  // Library keys are added for paths of shared libraries, the first path
+  // wins if several libraries share a name.
+  void add(std::string_view path, std::string_view replacement);
+
+  void write(const std::filesystem::path &file) const;
+
+private:
+  std::map<std::string, std::string, std::less<>> mPaths;
+  std::map<std::string, std::string, std::less<>> mLibraries;
+};
+} // namespace dpcpp_trace
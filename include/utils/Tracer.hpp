@@ -2,6 +2,7 @@
 
 #include "utils/RTTI.hpp"
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <span>
@@ -10,20 +11,49 @@
 namespace dpcpp_trace {
 namespace detail {
 class NativeTracerImpl;
+class SeccompTracerImpl;
 }
 
 class OpenHandler {
 public:
   virtual void replaceFilename(std::string_view newFile) const = 0;
+  // Process, that makes the call. Tracers follow all children and threads of
+  // the launched application.
+  virtual int pid() const = 0;
+  // Flags of the openat call.
+  virtual int flags() const = 0;
+  // Calls f with the result of the call, a file descriptor or -errno, once it
+  // returns. The calling thread of the tracee stays stopped until then, so
+  // this should only be requested for calls, whose result is needed.
+  virtual void onReturn(std::function<void(long)> f) const = 0;
   virtual ~OpenHandler() = default;
 };
 
 class StatHandler {
 public:
   virtual void replaceFilename(std::string_view newFile) const = 0;
+  // Process, that makes the call. Tracers follow all children and threads of
+  // the launched application.
+  virtual int pid() const = 0;
   virtual ~StatHandler() = default;
 };
 
+// Data transfer on a file descriptor.
+class IOHandler {
+public:
+  enum class Kind { Read, Write, MMap, Close };
+
+  virtual Kind kind() const = 0;
+  virtual int fd() const = 0;
+  // Bytes requested by read and write calls or mapped by mmap.
+  virtual size_t size() const = 0;
+  // Process, that makes the call.
+  virtual int pid() const = 0;
+  // Calls f with the result of the call once it returns, see OpenHandler.
+  virtual void onReturn(std::function<void(long)> f) const = 0;
+  virtual ~IOHandler() = default;
+};
+
 class Tracer : public RTTIRoot, public RTTIChild<Tracer> {
 public:
   constexpr static char ID = static_cast<size_t>(RTTIHierarchy::Tracer);
@@ -32,18 +62,31 @@ public:
       std::function<void(std::string_view, const OpenHandler &)>;
   using onStatHandler =
       std::function<void(std::string_view, const StatHandler &)>;
+  using onIOHandler = std::function<void(const IOHandler &)>;
 
   virtual void launch(std::string_view executable, std::span<std::string> args,
                       std::span<std::string> env) = 0;
 
   virtual void onFileOpen(onFileOpenHandler) = 0;
   virtual void onStat(onStatHandler) = 0;
+  // read, write, pread64, mmap and close calls are only intercepted, if the
+  // handler is set before the application is launched, since every one of
+  // them stops the application.
+  virtual void onIO(onIOHandler) = 0;
 
   virtual ~Tracer() = default;
 
+  // Event loop runs on a separate thread. Destroying the tracer kills the
+  // application, if it is still running.
   virtual void start() = 0;
+  // Blocks until the application exits, returns its exit code or the number
+  // of the signal, that terminated it.
   virtual int wait() = 0;
+  // Returns false if the application is still running after timeout.
+  virtual bool waitFor(std::chrono::milliseconds timeout) = 0;
+  // Kills the application with SIGKILL. wait() returns once it is reaped.
   virtual void kill() = 0;
+  // Sends SIGINT to the application.
   virtual void interrupt() = 0;
 
   void *cast(std::size_t type) override {
@@ -58,6 +101,7 @@ class NativeTracer : public Tracer {
 public:
   using onFileOpenHandler = Tracer::onFileOpenHandler;
   using onStatHandler = Tracer::onStatHandler;
+  using onIOHandler = Tracer::onIOHandler;
   NativeTracer();
 
   void launch(std::string_view executable, std::span<std::string> args,
@@ -66,13 +110,52 @@ public:
 
   void onFileOpen(onFileOpenHandler) final;
   void onStat(onStatHandler) final;
+  void onIO(onIOHandler) final;
 
   void start() final;
   int wait() final;
+  bool waitFor(std::chrono::milliseconds timeout) final;
   void kill() final;
   void interrupt() final;
 
 private:
   std::shared_ptr<detail::NativeTracerImpl> mImpl;
 };
+
+// Intercepts file accesses with seccomp user notifications instead of ptrace.
+// Only the calling thread of the tracee is stopped while a syscall is handled,
+// and the tracee stays free to be attached to by a debugger. Syscalls are
+// handled on numThreads threads, 0 means all cores, so handlers may be called
+// concurrently. Redirected opens and stats are performed by the tracer on
+// behalf of the tracee. Other calls are resumed without the tracer, so
+// OpenHandler::onReturn is only called for redirected opens, and onIO throws
+// std::runtime_error. Requires Linux 5.14 or newer.
+class SeccompTracer : public Tracer {
+public:
+  using onFileOpenHandler = Tracer::onFileOpenHandler;
+  using onStatHandler = Tracer::onStatHandler;
+  using onIOHandler = Tracer::onIOHandler;
+  explicit SeccompTracer(size_t numThreads = 0);
+
+  void launch(std::string_view executable, std::span<std::string> args,
+              std::span<std::string> env) final;
+  void fork(std::function<void()> child);
+
+  void onFileOpen(onFileOpenHandler) final;
+  void onStat(onStatHandler) final;
+  void onIO(onIOHandler) final;
+
+  void start() final;
+  int wait() final;
+  bool waitFor(std::chrono::milliseconds timeout) final;
+  void kill() final;
+  void interrupt() final;
+
+private:
+  std::shared_ptr<detail::SeccompTracerImpl> mImpl;
+};
+
+enum class TracerKind { Native, Seccomp };
+
+std::unique_ptr<Tracer> makeTracer(TracerKind kind);
 } // namespace dpcpp_trace
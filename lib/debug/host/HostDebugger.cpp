@@ -299,6 +299,11 @@ int HostDebugger::wait() {
   } while (type != eStateExited || type != eStateCrashed);
   return 0;
 }
+// Debugging sessions are not limited in time, debug rejects --timeout.
+bool HostDebugger::waitFor(std::chrono::milliseconds) {
+  throw std::runtime_error("Debugging sessions can not be waited for with a "
+                           "timeout");
+}
 void HostDebugger::start() {}
 void HostDebugger::kill() {}
 void HostDebugger::interrupt() {}
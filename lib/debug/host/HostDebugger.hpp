@@ -37,6 +37,7 @@ public:
 
   void onFileOpen(dpcpp_trace::Tracer::onFileOpenHandler handler) final{};
   void onStat(dpcpp_trace::Tracer::onStatHandler handler) final{};
+  void onIO(dpcpp_trace::Tracer::onIOHandler handler) final{};
 
   bool isAttached() final;
 
@@ -51,6 +52,7 @@ public:
 
   void start() final;
   int wait() final;
+  bool waitFor(std::chrono::milliseconds timeout) final;
   void kill() final;
   void interrupt() final;
 
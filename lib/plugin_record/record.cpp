@@ -1,21 +1,26 @@
 #include "constants.hpp"
 #include "record_handler.hpp"
+#include "thread_name.hpp"
 #include "write_utils.hpp"
 
 #include "pi_arguments_handler.hpp"
 #include "xpti_trace_framework.h"
 
 #include <chrono>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <ios>
-#include <pthread.h>
+#include <iostream>
 #include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 static uint8_t GStreamID = 0;
 
@@ -28,6 +33,40 @@ static bool shouldSkipMemObjects() {
   return res;
 }
 
+// Every line of the table is written at once, so that lines of threads of
+// different processes are not interleaved.
+static void addToThreadTable(const std::filesystem::path &outDir,
+                             const std::string &threadName) {
+  const std::string line = threadName + " " + std::to_string(getpid()) + " " +
+                           std::to_string(syscall(SYS_gettid)) + "\n";
+  std::ofstream table{outDir / kThreadTableName,
+                      std::ios::out | std::ios::app | std::ios::binary};
+  table.write(line.data(), line.size());
+}
+
+// Lets print align host I/O of the application with PI calls. The first
+// process of the application saves its start time, child processes use the
+// saved one, so that times of all traces have the same origin.
+static void shareStartTime(const std::filesystem::path &path) {
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                      0644);
+  if (fd == -1) {
+    int64_t startNs = 0;
+    if (errno == EEXIST && std::ifstream{path} >> startNs)
+      GStartTime = std::chrono::time_point<std::chrono::steady_clock>{
+          std::chrono::nanoseconds{startNs}};
+    return;
+  }
+
+  const std::string startNs =
+      std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         GStartTime.time_since_epoch())
+                         .count());
+  if (write(fd, startNs.data(), startNs.size()) == -1)
+    std::cerr << "Failed to save record start time\n";
+  close(fd);
+}
+
 XPTI_CALLBACK_API void tpCallback(uint16_t trace_type,
                                   xpti::trace_event_data_t *parent,
                                   xpti::trace_event_data_t *event,
@@ -59,6 +98,8 @@ XPTI_CALLBACK_API void xptiTraceInit(unsigned int major_version,
         tpCallback);
 
     GStartTime = std::chrono::steady_clock::now();
+    const std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
+    shareStartTime(outDir / kRecordStartTimeName);
   }
 }
 
@@ -75,10 +116,9 @@ XPTI_CALLBACK_API void tpCallback(uint16_t TraceType,
     const auto start = std::chrono::steady_clock::now();
     if (GRecordHandler == nullptr) {
       std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-      std::array<char, 1024> buf;
-      pthread_getname_np(pthread_self(), buf.data(), buf.size());
-      std::string filename{buf.data()};
-      filename += kPiTraceExt;
+      const std::string threadName{dpcpp_trace::getThreadName()};
+      addToThreadTable(outDir, threadName);
+      std::string filename = threadName + kPiTraceExt;
       auto fs = std::make_unique<std::ofstream>(
           outDir / filename, std::ios::out | std::ios::app | std::ios::binary);
       GRecordHandler =
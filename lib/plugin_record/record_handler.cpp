@@ -1,7 +1,9 @@
 #include "record_handler.hpp"
 #include "api_call.pb.h"
+#include "api_descriptors.hpp"
 #include "constants.hpp"
 #include "device_binary.pb.h"
+#include "thread_name.hpp"
 #include "utils.hpp"
 #include "write_utils.hpp"
 
@@ -12,6 +14,8 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 
 static std::atomic_bool GBinariesCollected = false;
 static std::mutex GBinariesMutex;
@@ -24,6 +28,68 @@ static void serialize(dpcpp_trace::APICall &call, std::ostream &os) {
   os.write(out.data(), size);
 }
 
+// Handles are opaque to the replay, but their values identify objects in info
+// queries, so replay hands out the very same values.
+template <typename T>
+static void collectHandleOutput(dpcpp_trace::APICall &call, T arg) {
+  if constexpr (isHandleOutput<T>) {
+    uint64_t handle = arg != nullptr ? bit_cast<uint64_t>(*arg) : 0;
+    call.add_small_outputs(reinterpret_cast<const char *>(&handle),
+                           sizeof(uint64_t));
+  }
+}
+
+template <typename T>
+static void collectHandleArray(dpcpp_trace::APICall &call, T *handles,
+                               pi_uint32 numHandles) {
+  std::string out;
+  for (pi_uint32 i = 0; handles != nullptr && i < numHandles; i++) {
+    uint64_t handle = bit_cast<uint64_t>(handles[i]);
+    out.append(reinterpret_cast<const char *>(&handle), sizeof(uint64_t));
+  }
+  call.add_small_outputs(std::move(out));
+}
+
+// Replay answers info queries of an object in the order they were recorded,
+// so a query, that repeats the previous answer to the same query, carries no
+// information. Answers, that change and change back, like reference counts,
+// are kept. Addresses of output buffers are only compared for nullness.
+static bool isDuplicateInfoQuery(const dpcpp_trace::APICall &call,
+                                 int paramIdx) {
+  static const bool elide = std::getenv(kElideInfoQueriesEnvVar) != nullptr;
+  if (!elide)
+    return false;
+
+  // Last answer to every query.
+  thread_local std::unordered_map<std::string, std::string> lastAnswers;
+
+  // Only the key is normalized, the recorded call keeps its values.
+  dpcpp_trace::APICall query = call;
+  query.clear_time_start();
+  query.clear_time_end();
+  for (int i = paramIdx + 1; i < query.args_size(); i++) {
+    auto &arg = *query.mutable_args(i);
+    if (arg.type() == dpcpp_trace::ArgData::POINTER)
+      arg.set_int_val(arg.int_val() != 0);
+  }
+
+  std::string answer = std::to_string(query.return_value());
+  for (const std::string &output : query.small_outputs())
+    answer += ":" + std::to_string(output.size()) + ":" + output;
+  query.clear_return_value();
+  query.clear_small_outputs();
+
+  std::string key;
+  query.SerializeToString(&key);
+  auto [it, inserted] = lastAnswers.try_emplace(std::move(key), answer);
+  if (inserted)
+    return false;
+  if (it->second == answer)
+    return true;
+  it->second = std::move(answer);
+  return false;
+}
+
 static void dumpBinaryDescriptor(pi_device_binary binary, pi_uint32 idx) {
   std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
   auto path = outDir / (std::to_string(idx) + ".desc");
@@ -174,6 +240,9 @@ void handlePlatformsGet(std::ostream &os, const uint32_t &funcId,
     size_t outSize = sizeof(pi_uint32);
     call.add_small_outputs(reinterpret_cast<char *>(numPlatforms), outSize);
   }
+  if (platforms != nullptr && res.value() == PI_SUCCESS) {
+    collectHandleArray(call, platforms, numEntries);
+  }
 
   serialize(call, os);
 }
@@ -195,6 +264,9 @@ void handleDevicesGet(std::ostream &os, const uint32_t &funcId,
     size_t outSize = sizeof(pi_uint32);
     call.add_small_outputs(reinterpret_cast<char *>(numDevices), outSize);
   }
+  if (devs != nullptr && res.value() == PI_SUCCESS) {
+    collectHandleArray(call, devs, numEntries);
+  }
 
   serialize(call, os);
 }
@@ -214,12 +286,11 @@ void handleEnqueueMemBufferMap(
   call.set_return_value(res.value());
   collectArgs(call, command_queue, buffer, blocking_map, map_flags, offset,
               size, num_events_in_wait_list, event_wait_list, event, ret_map);
+  collectHandleOutput(call, event);
 
   if (writeMemObj) {
     std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-    std::array<char, 1024> buf;
-    pthread_getname_np(pthread_self(), buf.data(), buf.size());
-    std::string filename{buf.data()};
+    std::string filename{dpcpp_trace::getThreadName()};
 
     filename += "_" + std::to_string(eventId) + ".mem";
 
@@ -253,12 +324,11 @@ void handleEnqueueMemBufferRead(
   call.set_return_value(res.value());
   collectArgs(call, queue, buffer, blocking_read, offset, size, ptr,
               num_events_in_wait_list, event_wait_list, event);
+  collectHandleOutput(call, event);
 
   if (writeMemObj) {
     std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-    std::array<char, 1024> buf;
-    pthread_getname_np(pthread_self(), buf.data(), buf.size());
-    std::string filename{buf.data()};
+    std::string filename{dpcpp_trace::getThreadName()};
 
     filename += "_" + std::to_string(eventId) + ".mem";
 
@@ -278,53 +348,6 @@ void handleEnqueueMemBufferRead(
   serialize(call, os);
 }
 
-void handleKernelGetGroupInfo(std::ostream &os, const uint32_t &funcId,
-                              const uint64_t &begin, const uint64_t &end,
-                              const pi_plugin &, std::optional<pi_result> res,
-                              pi_kernel kernel, pi_device device,
-                              pi_kernel_group_info param_name, size_t Size,
-                              void *Value, size_t *RetSize) {
-  dpcpp_trace::APICall call;
-  call.set_function_id(funcId);
-  call.set_time_start(begin);
-  call.set_time_end(end);
-  call.set_return_value(res.value());
-  collectArgs(call, kernel, device, param_name, Size, Value, RetSize);
-
-  if (Value != nullptr) {
-    call.add_small_outputs(reinterpret_cast<char *>(Value), Size);
-  }
-  if (RetSize != nullptr) {
-    size_t outSize = sizeof(size_t);
-    call.add_small_outputs(reinterpret_cast<char *>(RetSize), outSize);
-  }
-
-  serialize(call, os);
-}
-
-template <typename T1, typename T2>
-void handleGetInfo(std::ostream &os, const uint32_t &funcId,
-                   const uint64_t &begin, const uint64_t &end,
-                   const pi_plugin &, std::optional<pi_result> res, T1 obj,
-                   T2 param_name, size_t Size, void *Value, size_t *RetSize) {
-  dpcpp_trace::APICall call;
-  call.set_function_id(funcId);
-  call.set_time_start(begin);
-  call.set_time_end(end);
-  call.set_return_value(res.value());
-  collectArgs(call, obj, param_name, Size, Value, RetSize);
-
-  if (Value != nullptr) {
-    call.add_small_outputs(reinterpret_cast<char *>(Value), Size);
-  }
-  if (RetSize != nullptr) {
-    size_t outSize = sizeof(size_t);
-    call.add_small_outputs(reinterpret_cast<char *>(RetSize), outSize);
-  }
-
-  serialize(call, os);
-}
-
 void handleUSMEnqueueMemcpy(std::ostream &os, bool writeMemObj,
                             const uint64_t &eventId, const uint32_t &funcId,
                             const uint64_t &begin, const uint64_t &end,
@@ -341,6 +364,7 @@ void handleUSMEnqueueMemcpy(std::ostream &os, bool writeMemObj,
   call.set_return_value(res.value());
   collectArgs(call, queue, blocking, dst_ptr, src_ptr, size,
               num_events_in_waitlist, events_waitlist, event);
+  collectHandleOutput(call, event);
 
   pi_context context;
   pluginInfo.PiFunctionTable.piQueueGetInfo(
@@ -357,9 +381,7 @@ void handleUSMEnqueueMemcpy(std::ostream &os, bool writeMemObj,
 
   if (shouldSaveMem) {
     std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-    std::array<char, 1024> buf;
-    pthread_getname_np(pthread_self(), buf.data(), buf.size());
-    std::string filename{buf.data()};
+    std::string filename{dpcpp_trace::getThreadName()};
 
     filename += "_" + std::to_string(eventId) + ".mem";
 
@@ -379,6 +401,40 @@ void handleUSMEnqueueMemcpy(std::ostream &os, bool writeMemObj,
   serialize(call, os);
 }
 
+static void collectInfoOutputs(dpcpp_trace::APICall &call,
+                               const ApiDescriptor::InfoQuery &info) {
+  const auto *value =
+      reinterpret_cast<const char *>(call.args(info.value).int_val());
+  const auto *retSize =
+      reinterpret_cast<const char *>(call.args(info.retSize).int_val());
+
+  if (value != nullptr) {
+    call.add_small_outputs(value, call.args(info.valueSize).int_val());
+  }
+  if (retSize != nullptr) {
+    call.add_small_outputs(retSize, sizeof(size_t));
+  }
+}
+
+template <typename T>
+static void collectOutput(dpcpp_trace::APICall &call,
+                          const ApiDescriptor &desc, int idx, T arg) {
+  if constexpr (isHandleOutput<T>) {
+    if (idx == desc.handleArray)
+      collectHandleArray(call, arg,
+                         call.args(desc.handleArraySize).int_val());
+    else
+      collectHandleOutput(call, arg);
+  } else if constexpr (isScalarOutput<T>) {
+    if (idx == desc.scalarOutput) {
+      std::string out;
+      if (arg != nullptr)
+        out.assign(reinterpret_cast<const char *>(arg), sizeof(*arg));
+      call.add_small_outputs(std::move(out));
+    }
+  }
+}
+
 template <typename... Ts>
 static void basicHandler(std::ostream &os, const uint32_t &funcId,
                          const uint64_t &begin, const uint64_t &end,
@@ -390,6 +446,18 @@ static void basicHandler(std::ostream &os, const uint32_t &funcId,
   call.set_time_end(end);
   collectArgs(call, args...);
   call.set_return_value(res.value());
+
+  const ApiDescriptor desc =
+      getApiDescriptor(static_cast<sycl::detail::PiApiKind>(funcId));
+  if (desc.info.param >= 0) {
+    collectInfoOutputs(call, desc.info);
+    if (isDuplicateInfoQuery(call, desc.info.param))
+      return;
+  } else {
+    int idx = 0;
+    (collectOutput(call, desc, idx++, args), ...);
+  }
+
   serialize(call, os);
 }
 
@@ -428,23 +496,6 @@ RecordHandler::RecordHandler(
   mArgHandler.set_piEnqueueMemBufferMap(wrapMem(handleEnqueueMemBufferMap));
   mArgHandler.set_piEnqueueMemBufferRead(wrapMem(handleEnqueueMemBufferRead));
   mArgHandler.set_piextUSMEnqueueMemcpy(wrapMem(handleUSMEnqueueMemcpy));
-  mArgHandler.set_piPlatformGetInfo([this](auto &&...Args) {
-    handleGetInfo(*mOS, mLastFunctionId, mTimestampBegin, mTimestampEnd,
-                  Args...);
-  });
-  mArgHandler.set_piDeviceGetInfo([this](auto &&...Args) {
-    handleGetInfo(*mOS, mLastFunctionId, mTimestampBegin, mTimestampEnd,
-                  Args...);
-  });
-  mArgHandler.set_piContextGetInfo([this](auto &&...Args) {
-    handleGetInfo(*mOS, mLastFunctionId, mTimestampBegin, mTimestampEnd,
-                  Args...);
-  });
-  mArgHandler.set_piKernelGetInfo([this](auto &&...Args) {
-    handleGetInfo(*mOS, mLastFunctionId, mTimestampBegin, mTimestampEnd,
-                  Args...);
-  });
-  mArgHandler.set_piKernelGetGroupInfo(wrap(handleKernelGetGroupInfo));
 }
 
 void RecordHandler::handle(uint64_t eventId, uint32_t funcId,
@@ -0,0 +1,155 @@
+#include "info_index.hpp"
+#include "api_descriptors.hpp"
+#include "constants.hpp"
+
+#include <CL/sycl/detail/pi.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+using namespace sycl::detail;
+
+bool InfoIndex::Answer::apply(size_t valueSize, void *outValue,
+                              size_t *retSize) const {
+  if (outValue != nullptr) {
+    if (!value)
+      return false;
+    std::copy_n(value->begin(), std::min(valueSize, value->size()),
+                static_cast<char *>(outValue));
+  }
+
+  if (retSize != nullptr) {
+    if (size)
+      *retSize = *size;
+    else if (value)
+      *retSize = value->size();
+    else
+      return false;
+  }
+
+  return true;
+}
+
+size_t InfoIndex::KeyHash::operator()(const Key &key) const noexcept {
+  size_t hash = std::hash<uint64_t>{}(key.handle);
+  const auto combine = [&hash](uint64_t value) {
+    hash ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull +
+            (hash << 6) + (hash >> 2);
+  };
+  combine(key.funcId);
+  combine(key.subObject);
+  combine(key.param);
+  return hash;
+}
+
+void InfoIndex::build(const std::filesystem::path &traceDir) {
+  std::string buffer;
+  dpcpp_trace::APICall call;
+
+  for (const auto &entry : std::filesystem::directory_iterator(traceDir)) {
+    if (entry.path().extension() != kPiTraceExt)
+      continue;
+
+    std::ifstream is{entry.path(), std::ios::binary};
+    uint32_t size;
+    while (is.read(reinterpret_cast<char *>(&size), sizeof(uint32_t))) {
+      buffer.resize(size);
+      if (!is.read(buffer.data(), size) ||
+          !call.ParseFromArray(buffer.data(), size))
+        break;
+
+      // Recorders, that save handle values, do so for every created context.
+      if (call.function_id() ==
+              static_cast<uint32_t>(PiApiKind::piContextCreate) &&
+          call.small_outputs_size() > 0)
+        mHasHandles = true;
+
+      add(call);
+    }
+  }
+
+  // Traces of threads are read one after another.
+  const auto byTime = [](const Answer *a, const Answer *b) {
+    return a->time < b->time;
+  };
+  for (auto &[key, sequence] : mAnswers)
+    std::stable_sort(sequence.answers.begin(), sequence.answers.end(), byTime);
+  for (auto &[key, sequence] : mAnyAnswers)
+    std::stable_sort(sequence.answers.begin(), sequence.answers.end(), byTime);
+}
+
+void InfoIndex::add(const dpcpp_trace::APICall &call) {
+  const ApiDescriptor::InfoQuery info =
+      getApiDescriptor(static_cast<PiApiKind>(call.function_id())).info;
+  if (info.param < 0 || info.retSize >= call.args_size())
+    return;
+
+  Key key;
+  key.funcId = call.function_id();
+  key.handle = call.args(0).int_val();
+  key.subObject =
+      info.subObject >= 0 ? call.args(info.subObject).int_val() : 0;
+  key.param = call.args(info.param).int_val();
+
+  const bool hasValue = call.args(info.value).int_val() != 0;
+  const bool hasSize = call.args(info.retSize).int_val() != 0;
+  if (call.small_outputs_size() < hasValue + hasSize)
+    return;
+
+  Answer &answer = mStorage.emplace_back();
+  answer.result = call.return_value();
+  answer.time = call.time_start();
+  if (hasValue)
+    answer.value = call.small_outputs(0);
+  if (hasSize) {
+    uint64_t size = 0;
+    const std::string &out = call.small_outputs(hasValue ? 1 : 0);
+    std::memcpy(&size, out.data(), std::min(out.size(), sizeof(uint64_t)));
+    answer.size = size;
+  }
+
+  mAnswers[key].answers.push_back(&answer);
+  mAnyAnswers[{key.funcId, key.param}].answers.push_back(&answer);
+}
+
+const InfoIndex::Answer *InfoIndex::takeNext(Sequence &sequence,
+                                             bool needsValue, bool needsSize) {
+  // Runtime asks for the size first and for the value afterwards, so answers,
+  // that lack requested outputs, are skipped.
+  const auto covers = [=](const Answer *answer) {
+    return (!needsValue || answer->value) &&
+           (!needsSize || answer->size || answer->value);
+  };
+
+  const auto &answers = sequence.answers;
+  for (size_t i = sequence.next; i < answers.size(); i++) {
+    if (covers(answers[i])) {
+      sequence.next = i + 1;
+      return answers[i];
+    }
+  }
+  for (size_t i = answers.size(); i > 0; i--) {
+    if (covers(answers[i - 1]))
+      return answers[i - 1];
+  }
+  return nullptr;
+}
+
+const InfoIndex::Answer *InfoIndex::find(uint32_t funcId, uint64_t handle,
+                                         uint64_t subObject, uint64_t param,
+                                         bool needsValue, bool needsSize) {
+  std::lock_guard lock{mMutex};
+  auto it = mAnswers.find(Key{funcId, handle, subObject, param});
+  return it != mAnswers.end() ? takeNext(it->second, needsValue, needsSize)
+                              : nullptr;
+}
+
+const InfoIndex::Answer *InfoIndex::findAny(uint32_t funcId, uint64_t param,
+                                            bool needsValue, bool needsSize) {
+  std::lock_guard lock{mMutex};
+  auto it = mAnyAnswers.find({funcId, param});
+  return it != mAnyAnswers.end() ? takeNext(it->second, needsValue, needsSize)
+                                 : nullptr;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "api_call.pb.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Answers to info queries of all recorded threads, keyed by the queried
+// object, so that replayed application may issue queries in any order. Every
+// recorded answer is kept, and answers of an object are returned in the order
+// they were recorded, since some of them change over time, like event status
+// or reference counts, and freed handles may be reused by new objects.
+class InfoIndex {
+public:
+  struct Answer {
+    std::optional<std::string> value;
+    std::optional<uint64_t> size;
+    uint32_t result = 0;
+    uint64_t time = 0;
+
+    // Copies recorded answer to the query outputs. Returns false if the
+    // requested outputs were never recorded.
+    bool apply(size_t valueSize, void *value, size_t *retSize) const;
+  };
+
+  // Scans all traces in traceDir. Must be called before any lookups.
+  void build(const std::filesystem::path &traceDir);
+
+  // Traces, that do not contain values of created handles, can not be
+  // looked up by object and must be replayed sequentially.
+  bool hasHandles() const noexcept { return mHasHandles; }
+
+  // Returns the next recorded answer of the object, that has the requested
+  // outputs. Once all of them are used, the last one is repeated. subObject is
+  // 0 for queries, that are identified by a single object. Thread-safe.
+  const Answer *find(uint32_t funcId, uint64_t handle, uint64_t subObject,
+                     uint64_t param, bool needsValue, bool needsSize);
+
+  // Same as find for answers of this parameter regardless of the object.
+  const Answer *findAny(uint32_t funcId, uint64_t param, bool needsValue,
+                        bool needsSize);
+
+private:
+  struct Key {
+    uint32_t funcId;
+    uint64_t handle;
+    uint64_t subObject;
+    uint64_t param;
+
+    bool operator==(const Key &other) const noexcept {
+      return funcId == other.funcId && handle == other.handle &&
+             subObject == other.subObject && param == other.param;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const noexcept;
+  };
+
+  // Answers in recorded order and the position of the next one.
+  struct Sequence {
+    std::vector<const Answer *> answers;
+    size_t next = 0;
+  };
+
+  void add(const dpcpp_trace::APICall &call);
+  const Answer *takeNext(Sequence &sequence, bool needsValue, bool needsSize);
+
+  // Elements of a deque are not moved, when new ones are added.
+  std::deque<Answer> mStorage;
+  std::unordered_map<Key, Sequence, KeyHash> mAnswers;
+  std::map<std::pair<uint32_t, uint64_t>, Sequence> mAnyAnswers;
+  std::mutex mMutex;
+  bool mHasHandles = false;
+};
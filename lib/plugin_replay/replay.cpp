@@ -1,39 +1,32 @@
 #include "api_call.pb.h"
+#include "api_descriptors.hpp"
 #include "constants.hpp"
+#include "info_index.hpp"
+#include "thread_name.hpp"
+#include "trace_reader.hpp"
 
 #include <CL/sycl/detail/pi.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <map>
 #include <memory>
-#include <pthread.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace sycl::detail;
 
-size_t GOffset = 0;
-thread_local std::ifstream GTrace;
-
-std::map<pi_kernel, pi_program> GKernelProgramMap;
-std::map<pi_mem, pi_context> GMemContextMap;
-
-static void ensureTraceOpened() {
-  if (!GTrace.is_open()) {
-    std::filesystem::path traceDir{getenv(kTracePathEnvVar)};
-    std::array<char, 1024> buf;
-    pthread_getname_np(pthread_self(), buf.data(), buf.size());
-    std::string filename{buf.data()};
-    filename += kPiTraceExt;
-    auto traceFile = traceDir / filename;
-
-    GTrace = std::ifstream(traceFile, std::ios::binary);
-  }
-}
-
 static std::string funcIdToString(uint32_t funcId) {
   switch (static_cast<PiApiKind>(funcId)) {
 #define _PI_API(api) \
@@ -46,372 +39,565 @@ static std::string funcIdToString(uint32_t funcId) {
   }
 }
 
-void dieIfUnexpected(uint32_t funcId, PiApiKind expected) {
-  if (funcId != static_cast<uint32_t>(expected)) {
-    std::cerr << "Unexpected PI call: got " << funcIdToString(funcId) << " ("
-              << funcId << ") ";
-    std::cerr << " expected "
-              << funcIdToString(static_cast<uint32_t>(expected));
-    std::cerr << "\n";
-    exit(-1);
-  }
+static bool isTolerantMode() {
+  static bool res = getenv(kReplayTolerantEnvVar) != nullptr;
+  return res;
 }
 
-void replayGetInfo(dpcpp_trace::APICall &record, void *paramValue,
-                   size_t *retSize) {
-  char *ptr = paramValue ? static_cast<char *>(paramValue)
-                         : reinterpret_cast<char *>(retSize);
-  std::uninitialized_copy(record.small_outputs(0).begin(),
-                          record.small_outputs(0).end(), ptr);
+static bool isBenchMode() {
+  static bool res = getenv(kReplayBenchEnvVar) != nullptr;
+  return res;
 }
 
-extern "C" {
+// In fast mode memory object payloads are not read from disk. Replayed
+// application gets garbage data, but the time spent between PI calls is
+// dominated by the SYCL runtime itself.
+static bool isFastMode() {
+  static bool res = getenv(kReplayFastEnvVar) != nullptr;
+  return res;
+}
 
-dpcpp_trace::APICall getNextRecord(std::ifstream &is) {
-  uint32_t size;
-  is.read(reinterpret_cast<char *>(&size), sizeof(uint32_t));
-  std::string rawData;
-  rawData.resize(size + 1);
-  is.read(rawData.data(), size);
+// Collects per-thread replay statistics for dpcpp_trace replay --bench. The
+// time between the end of the previous PI call and the beginning of the next
+// one is attributed to the runtime, the rest is the cost of the plugin itself.
+class ReplayStats {
+public:
+  using clock = std::chrono::steady_clock;
 
-  dpcpp_trace::APICall call;
-  call.ParseFromString(rawData);
+  ~ReplayStats() {
+    if (mThreadName.empty() || mStats.empty())
+      return;
 
-  return call;
-}
+    std::filesystem::path benchDir{getenv(kReplayBenchEnvVar)};
+    std::ofstream os{benchDir / (mThreadName + kReplayBenchExt)};
+    for (size_t i = 0; i < mStats.size(); i++) {
+      const auto &s = mStats[i];
+      if (s.calls == 0)
+        continue;
+      os << funcIdToString(i) << " " << s.calls << " " << s.runtimeNs << " "
+         << s.pluginNs << "\n";
+    }
+  }
 
-pi_result piPlatformsGet(pi_uint32 numEntries, pi_platform *platforms,
-                         pi_uint32 *numPlatforms) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  void setThreadName(std::string name) { mThreadName = std::move(name); }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piPlatformsGet);
+  void add(uint32_t funcId, clock::time_point start, clock::time_point end) {
+    if (funcId >= mStats.size())
+      mStats.resize(funcId + 1);
 
-  if (numPlatforms != nullptr) {
-    *numPlatforms =
-        *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
+    auto &s = mStats[funcId];
+    s.calls++;
+    if (mHasLastEnd)
+      s.runtimeNs += toNs(start - mLastEnd);
+    s.pluginNs += toNs(end - start);
+
+    mLastEnd = end;
+    mHasLastEnd = true;
   }
 
-  if (numEntries > 0 && platforms != nullptr) {
-    for (size_t i = 0; i < numEntries; i++) {
-      platforms[i] = reinterpret_cast<pi_platform>(new int{1});
-    }
+private:
+  struct Entry {
+    uint64_t calls = 0;
+    uint64_t runtimeNs = 0;
+    uint64_t pluginNs = 0;
+  };
+
+  static uint64_t toNs(clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
   }
 
-  return static_cast<pi_result>(record.return_value());
-}
+  std::string mThreadName;
+  std::vector<Entry> mStats;
+  clock::time_point mLastEnd;
+  bool mHasLastEnd = false;
+};
 
-pi_result piPlatformGetInfo(pi_platform platform, pi_platform_info param_name,
-                            size_t param_value_size, void *param_value,
-                            size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+static size_t getLookahead() {
+  static size_t res = [] {
+    const char *val = getenv(kReplayLookaheadEnvVar);
+    return val ? std::stoul(val) : kReplayDefaultLookahead;
+  }();
+  return res;
+}
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piPlatformGetInfo);
+thread_local std::unique_ptr<TraceReader> GReader;
+thread_local bool GHasCurrentRecord = false;
+thread_local ReplayStats GStats;
 
-  replayGetInfo(record, param_value, param_value_size_ret);
+std::map<pi_kernel, pi_program> GKernelProgramMap;
+std::map<pi_mem, pi_context> GMemContextMap;
 
-  return static_cast<pi_result>(record.return_value());
-}
+// Host memory, that buffer maps return. It is freed on unmap, and mappings,
+// that the runtime never unmaps, are freed with the last reference to their
+// buffer, so that RSS reported by --bench does not grow with every map.
+class MappedMemory {
+public:
+  char *map(pi_mem mem, size_t size) {
+    auto data = std::make_unique<char[]>(size);
+    char *ptr = data.get();
+    std::lock_guard lock{mMutex};
+    mMappings[ptr] = {mem, std::move(data)};
+    return ptr;
+  }
 
-pi_result piDevicesGet(pi_platform platform, pi_device_type type,
-                       pi_uint32 numEntries, pi_device *devs,
-                       pi_uint32 *numDevices) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  void unmap(void *ptr) {
+    std::lock_guard lock{mMutex};
+    mMappings.erase(ptr);
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piDevicesGet);
+  void create(pi_mem mem) {
+    std::lock_guard lock{mMutex};
+    mRefCounts[mem] = 1;
+  }
 
-  if (numDevices != nullptr) {
-    *numDevices =
-        *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
+  void retain(pi_mem mem) {
+    std::lock_guard lock{mMutex};
+    if (auto it = mRefCounts.find(mem); it != mRefCounts.end())
+      it->second++;
   }
 
-  if (numEntries > 0 && devs != nullptr) {
-    for (size_t i = 0; i < numEntries; i++) {
-      devs[i] = reinterpret_cast<pi_device>(new int{1});
-    }
+  void release(pi_mem mem) {
+    std::lock_guard lock{mMutex};
+    auto it = mRefCounts.find(mem);
+    if (it == mRefCounts.end() || --it->second != 0)
+      return;
+    mRefCounts.erase(it);
+    std::erase_if(mMappings, [mem](const auto &mapping) {
+      return mapping.second.first == mem;
+    });
   }
 
-  return static_cast<pi_result>(record.return_value());
-}
+private:
+  std::mutex mMutex;
+  std::unordered_map<void *, std::pair<pi_mem, std::unique_ptr<char[]>>>
+      mMappings;
+  std::unordered_map<pi_mem, size_t> mRefCounts;
+};
 
-pi_result piDeviceGetInfo(pi_device device, pi_device_info param_name,
-                          size_t param_value_size, void *param_value,
-                          size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+MappedMemory GMappedMemory;
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piDeviceGetInfo);
+static void ensureTraceOpened() {
+  if (!GReader) {
+    std::filesystem::path traceDir{getenv(kTracePathEnvVar)};
+    std::string threadName{dpcpp_trace::getThreadName()};
+    auto traceFile = traceDir / (threadName + kPiTraceExt);
 
-  replayGetInfo(record, param_value, param_value_size_ret);
+    GReader = std::make_unique<TraceReader>(traceFile, traceDir / kBuffersPath,
+                                            getLookahead(), !isFastMode());
 
-  return static_cast<pi_result>(record.return_value());
+    if (isBenchMode())
+      GStats.setThreadName(std::move(threadName));
+  }
 }
 
-pi_result piDeviceRetain(pi_device) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piDeviceRetain);
-  return static_cast<pi_result>(record.return_value());
+void dieIfUnexpected(uint32_t funcId, PiApiKind expected) {
+  if (funcId != static_cast<uint32_t>(expected)) {
+    std::cerr << "Unexpected PI call: got " << funcIdToString(funcId) << " ("
+              << funcId << ") ";
+    std::cerr << " expected "
+              << funcIdToString(static_cast<uint32_t>(expected));
+    std::cerr << "\n";
+    exit(-1);
+  }
 }
 
-pi_result piDeviceRelease(pi_device) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+// Records the difference between the trace and the replayed application in
+// tolerant mode and prints it when the application exits.
+class DivergenceSummary {
+public:
+  ~DivergenceSummary() {
+    if (mStats.empty())
+      return;
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piDeviceRelease);
-  return static_cast<pi_result>(record.return_value());
-}
+    std::cerr << "Replay divergence summary:\n";
+    for (const auto &[funcId, stats] : mStats) {
+      std::cerr << "  " << funcIdToString(funcId) << ": " << stats.skipped
+                << " skipped, " << stats.inserted
+                << " answered from other objects\n";
+    }
+  }
 
-pi_result piContextCreate(const pi_context_properties *properties,
-                          pi_uint32 num_devices, const pi_device *devices,
-                          void (*pfn_notify)(const char *errinfo,
-                                             const void *private_info,
-                                             size_t cb, void *user_data),
-                          void *user_data, pi_context *ret_context) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  void skipped(uint32_t funcId) {
+    std::lock_guard lock{mMutex};
+    mStats[funcId].skipped++;
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piContextCreate);
-  *ret_context = reinterpret_cast<pi_context>(new int{1});
-  return static_cast<pi_result>(record.return_value());
-}
+  void inserted(uint32_t funcId) {
+    std::lock_guard lock{mMutex};
+    mStats[funcId].inserted++;
+  }
 
-pi_result piContextGetInfo(pi_context context, pi_context_info param_name,
-                           size_t param_value_size, void *param_value,
-                           size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+private:
+  struct Entry {
+    size_t skipped = 0;
+    size_t inserted = 0;
+  };
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piContextGetInfo);
+  std::mutex mMutex;
+  std::map<uint32_t, Entry> mStats;
+};
 
-  replayGetInfo(record, param_value, param_value_size_ret);
+static DivergenceSummary GDivergence;
 
-  return static_cast<pi_result>(record.return_value());
+// Answers to info queries of the whole trace, built when the plugin is loaded.
+static InfoIndex GInfoIndex;
+
+static bool matches(const dpcpp_trace::APICall &call, PiApiKind expected,
+                    std::optional<uint64_t> param) {
+  if (call.function_id() != static_cast<uint32_t>(expected))
+    return false;
+  const int paramIdx = getApiDescriptor(expected).info.param;
+  if (!param || paramIdx < 0 || paramIdx >= call.args_size())
+    return true;
+  return call.args(paramIdx).int_val() == *param;
 }
 
-pi_result piContextRelease(pi_context) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+static TraceReader::Record *getFrontOrDie() {
+  TraceReader::Record *record = GReader->front();
+  if (record == nullptr) {
+    std::cerr << "Unexpected end of trace\n";
+    exit(-1);
+  }
+  return record;
+}
+
+// Looks for the expected call within the lookahead window. Info queries, that
+// the application no longer makes, are skipped. Returns nullptr for extra info
+// queries.
+static dpcpp_trace::APICall *findTolerant(PiApiKind expected,
+                                          std::optional<uint64_t> param) {
+  for (size_t n = 0; n < GReader->capacity(); n++) {
+    TraceReader::Record *record = GReader->peek(n);
+    if (record == nullptr)
+      break;
+
+    if (matches(record->call, expected, param)) {
+      for (size_t i = 0; i < n; i++) {
+        GDivergence.skipped(GReader->front()->call.function_id());
+        GReader->pop();
+      }
+      GHasCurrentRecord = true;
+      return &record->call;
+    }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piContextRelease);
-  return static_cast<pi_result>(record.return_value());
-}
+    if (!isInfoQuery(record->call.function_id()))
+      break;
+  }
 
-pi_result piContextRetain(pi_context) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  // Extra info queries are answered by the caller.
+  if (param)
+    return nullptr;
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piContextRetain);
-  return static_cast<pi_result>(record.return_value());
+  TraceReader::Record *record = getFrontOrDie();
+  dieIfUnexpected(record->call.function_id(), expected);
+  GHasCurrentRecord = true;
+  return &record->call;
 }
 
-pi_result piQueueCreate(pi_context context, pi_device device,
-                        pi_queue_properties properties, pi_queue *queue) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+// Returns the next record of the current thread trace. The record stays valid
+// until the next call. param is the param_name argument of info queries, which
+// are only read from the trace, if it has no recorded handles.
+static dpcpp_trace::APICall *nextRecord(PiApiKind expected,
+                                        std::optional<uint64_t> param) {
+  const auto start = ReplayStats::clock::now();
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piQueueCreate);
-  *queue = reinterpret_cast<pi_queue>(new int{1});
-  return static_cast<pi_result>(record.return_value());
-}
+  if (GHasCurrentRecord) {
+    GReader->pop();
+    GHasCurrentRecord = false;
+  }
 
-pi_result piQueueGetInfo(pi_queue command_queue, pi_queue_info param_name,
-                         size_t param_value_size, void *param_value,
-                         size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  // Info queries are answered from the index.
+  if (GInfoIndex.hasHandles()) {
+    for (auto *record = GReader->front();
+         record != nullptr && isInfoQuery(record->call.function_id());
+         record = GReader->front())
+      GReader->pop();
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piQueueGetInfo);
+  dpcpp_trace::APICall *call = nullptr;
+  if (isTolerantMode()) {
+    call = findTolerant(expected, param);
+  } else {
+    TraceReader::Record *record = getFrontOrDie();
+    dieIfUnexpected(record->call.function_id(), expected);
+    GHasCurrentRecord = true;
+    call = &record->call;
+  }
 
-  replayGetInfo(record, param_value, param_value_size_ret);
+  if (isBenchMode() && call != nullptr)
+    GStats.add(call->function_id(), start, ReplayStats::clock::now());
 
-  return static_cast<pi_result>(record.return_value());
+  return call;
 }
 
-pi_result piQueueRetain(pi_queue) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+static dpcpp_trace::APICall &getNextRecord(PiApiKind expected) {
+  return *nextRecord(expected, std::nullopt);
+}
+
+static void dieUnrecordedInfoQuery(PiApiKind kind, uint64_t param) {
+  std::cerr << "Info query was not recorded: "
+            << funcIdToString(static_cast<uint32_t>(kind)) << " param "
+            << param << "\n";
+  exit(-1);
+}
+
+// Answers an info query. Traces with recorded handles are looked up by object
+// and param_name, so the application may issue queries in any order. Older
+// traces are replayed sequentially.
+static pi_result replayGetInfo(PiApiKind kind, uint64_t handle,
+                               uint64_t subObject, uint64_t param,
+                               size_t valueSize, void *value,
+                               size_t *retSize) {
+  const auto start = ReplayStats::clock::now();
+  const auto funcId = static_cast<uint32_t>(kind);
+
+  if (!GInfoIndex.hasHandles()) {
+    auto *record = nextRecord(kind, param);
+    if (record && record->small_outputs_size() == 0)
+      return static_cast<pi_result>(record->return_value());
+    if (record) {
+      char *ptr = value ? static_cast<char *>(value)
+                        : reinterpret_cast<char *>(retSize);
+      std::uninitialized_copy(record->small_outputs(0).begin(),
+                              record->small_outputs(0).end(), ptr);
+      return static_cast<pi_result>(record->return_value());
+    }
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piQueueRetain);
-  return static_cast<pi_result>(record.return_value());
-}
+  const InfoIndex::Answer *answer = nullptr;
+  if (GInfoIndex.hasHandles()) {
+    answer = GInfoIndex.find(funcId, handle, subObject, param,
+                             value != nullptr, retSize != nullptr);
+    if (answer && !answer->apply(valueSize, value, retSize))
+      answer = nullptr;
+  }
 
-pi_result piQueueRelease(pi_queue command_queue) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  if (!answer && isTolerantMode()) {
+    answer = GInfoIndex.findAny(funcId, param, value != nullptr,
+                                retSize != nullptr);
+    if (answer && answer->apply(valueSize, value, retSize))
+      GDivergence.inserted(funcId);
+    else
+      answer = nullptr;
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piQueueRelease);
-  return static_cast<pi_result>(record.return_value());
-}
+  if (!answer)
+    dieUnrecordedInfoQuery(kind, param);
 
-pi_result piQueueFinish(pi_queue command_queue) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  if (isBenchMode())
+    GStats.add(funcId, start, ReplayStats::clock::now());
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piQueueFinish);
-  return static_cast<pi_result>(record.return_value());
+  return static_cast<pi_result>(answer->result);
 }
 
-pi_result piMemBufferCreate(pi_context context, pi_mem_flags flags, size_t size,
-                            void *host_ptr, pi_mem *ret_mem,
-                            const pi_mem_properties *properties) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+// Returns the idx-th handle, that the current record has created. Traces
+// without recorded handles get a fresh dummy object.
+template <typename T>
+static T getHandleOutput(const dpcpp_trace::APICall &record, int idx) {
+  uint64_t handle = 0;
+  if (idx < record.small_outputs_size() &&
+      record.small_outputs(idx).size() == sizeof(uint64_t))
+    std::memcpy(&handle, record.small_outputs(idx).data(), sizeof(uint64_t));
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piMemBufferCreate);
-  *ret_mem = reinterpret_cast<pi_mem>(new int{1});
-  GMemContextMap[*ret_mem] = context;
-  return static_cast<pi_result>(record.return_value());
+  if (handle == 0)
+    return reinterpret_cast<T>(new int{1});
+  return reinterpret_cast<T>(handle);
 }
 
-pi_result piMemGetInfo(pi_mem mem, cl_mem_info param_name,
-                       size_t param_value_size, void *param_value,
-                       size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piMemGetInfo);
+template <typename T>
+static void setHandleOutput(const dpcpp_trace::APICall &record, int idx,
+                            T *out) {
+  if (out != nullptr)
+    *out = getHandleOutput<T>(record, idx);
+}
 
-  replayGetInfo(record, param_value, param_value_size_ret);
+// Fills an array of handles returned by piPlatformsGet or piDevicesGet.
+template <typename T>
+static void setHandleArray(const dpcpp_trace::APICall &record, int idx,
+                           T *out, pi_uint32 numEntries) {
+  std::string_view handles;
+  if (idx < record.small_outputs_size())
+    handles = record.small_outputs(idx);
 
-  if (param_name == CL_MEM_CONTEXT) {
-    *static_cast<pi_context *>(param_value) = GMemContextMap[mem];
+  for (pi_uint32 i = 0; i < numEntries; i++) {
+    uint64_t handle = 0;
+    if ((i + 1) * sizeof(uint64_t) <= handles.size())
+      std::memcpy(&handle, handles.data() + i * sizeof(uint64_t),
+                  sizeof(uint64_t));
+    out[i] = handle != 0 ? reinterpret_cast<T>(handle)
+                         : reinterpret_cast<T>(new int{1});
   }
-
-  return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piMemImageGetInfo(pi_mem image, pi_image_info param_name,
-                            size_t param_value_size, void *param_value,
-                            size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piMemImageGetInfo);
-
-  replayGetInfo(record, param_value, param_value_size_ret);
+// Returns contents of the memory object, that current record refers to.
+static const std::vector<char> &getMemOutput(size_t idx) {
+  return GReader->front()->memOutputs[idx];
+}
 
-  return static_cast<pi_result>(record.return_value());
+template <typename T> static uint64_t toRawArg(T arg) {
+  if constexpr (std::is_pointer_v<T>)
+    return reinterpret_cast<uint64_t>(arg);
+  else
+    return static_cast<uint64_t>(arg);
 }
 
-pi_result piMemRetain(pi_mem mem) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+// Restores idx-th argument of a replayed call, outIdx is the index of the next
+// small output in the record. Must match collectOutput in the record plugin.
+template <typename T>
+static void restoreOutput(const dpcpp_trace::APICall &record,
+                          const ApiDescriptor &desc, int idx, int &outIdx,
+                          T arg) {
+  if constexpr (isHandleOutput<T>) {
+    if (idx == desc.handleArray) {
+      if (arg != nullptr)
+        setHandleArray(record, outIdx, arg,
+                       record.args(desc.handleArraySize).int_val());
+    } else {
+      setHandleOutput(record, outIdx, arg);
+    }
+    outIdx++;
+  } else if constexpr (std::is_same_v<T, void **>) {
+    if (idx == desc.allocPtr && arg != nullptr)
+      *arg = new char[record.args(desc.allocSize).int_val()];
+  } else if constexpr (isScalarOutput<T>) {
+    if (idx == desc.scalarOutput) {
+      if (arg != nullptr && outIdx < record.small_outputs_size() &&
+          record.small_outputs(outIdx).size() == sizeof(*arg))
+        std::memcpy(arg, record.small_outputs(outIdx).data(), sizeof(*arg));
+      outIdx++;
+    }
+  }
+}
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piMemImageGetInfo);
+// Replays any function from pi.def according to its descriptor. Functions,
+// that restore memory contents or keep replay state, are hand-written below.
+template <PiApiKind Kind, typename Fn> struct GenericEntry;
+
+template <PiApiKind Kind, typename... Ts>
+struct GenericEntry<Kind, pi_result (*)(Ts...)> {
+  static constexpr ApiDescriptor kDesc = getApiDescriptor(Kind);
+  static constexpr ApiDescriptor::InfoQuery kInfo = kDesc.info;
+
+  static_assert(kDesc.scalarOutput < 0 ||
+                    argSatisfies<IsScalarOutput, Ts...>(kDesc.scalarOutput),
+                "Scalar output must be a pointer to a value");
+  static_assert(kDesc.handleArray < 0 ||
+                    argSatisfies<IsHandleOutput, Ts...>(kDesc.handleArray),
+                "Handle array must be a pointer to handles");
+  static_assert(kDesc.allocPtr < 0 ||
+                    argSatisfies<IsAllocOutput, Ts...>(kDesc.allocPtr),
+                "USM allocation result must be void **");
+  static_assert(kInfo.param < 0 ||
+                    (argSatisfies<std::is_pointer, Ts...>(kInfo.value) &&
+                     argSatisfies<IsSizeOutput, Ts...>(kInfo.retSize)),
+                "Info query layout does not match the signature");
+
+  static pi_result call(Ts... args) {
+    ensureTraceOpened();
+
+    if constexpr (kInfo.param >= 0) {
+      const std::array<uint64_t, sizeof...(Ts)> raw = {toRawArg(args)...};
+      return replayGetInfo(Kind, raw[0],
+                           kInfo.subObject >= 0 ? raw[kInfo.subObject] : 0,
+                           raw[kInfo.param], raw[kInfo.valueSize],
+                           reinterpret_cast<void *>(raw[kInfo.value]),
+                           reinterpret_cast<size_t *>(raw[kInfo.retSize]));
+    } else {
+      auto &record = getNextRecord(Kind);
+      int idx = 0;
+      int outIdx = 0;
+      (restoreOutput(record, kDesc, idx++, outIdx, args), ...);
+      return static_cast<pi_result>(record.return_value());
+    }
+  }
+};
 
-  return static_cast<pi_result>(record.return_value());
-}
+extern "C" {
 
-pi_result piextDeviceSelectBinary(pi_device device, pi_device_binary *binaries,
-                                  pi_uint32 num_binaries,
-                                  pi_uint32 *selected_binary_ind) {
+pi_result piPlatformsGet(pi_uint32 numEntries, pi_platform *platforms,
+                         pi_uint32 *numPlatforms) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  auto &record = getNextRecord(PiApiKind::piPlatformsGet);
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piextDeviceSelectBinary);
-  *selected_binary_ind =
-      *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
-
-  return static_cast<pi_result>(record.return_value());
-}
+  if (numPlatforms != nullptr) {
+    *numPlatforms =
+        *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
+  }
 
-pi_result piProgramCreateWithBinary(
-    pi_context context, pi_uint32 num_devices, const pi_device *device_list,
-    const size_t *lengths, const unsigned char **binaries,
-    size_t num_metadata_entries, const pi_device_binary_property *metadata,
-    pi_int32 *binary_status, pi_program *ret_program) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  if (numEntries > 0 && platforms != nullptr) {
+    setHandleArray(record, numPlatforms != nullptr ? 1 : 0, platforms,
+                   numEntries);
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramCreateWithBinary);
-  *ret_program = reinterpret_cast<pi_program>(new int{1});
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piProgramCreate(pi_context context, const void *il, size_t length,
-                          pi_program *ret_program) {
+pi_result piDevicesGet(pi_platform platform, pi_device_type type,
+                       pi_uint32 numEntries, pi_device *devs,
+                       pi_uint32 *numDevices) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  auto &record = getNextRecord(PiApiKind::piDevicesGet);
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramCreate);
-  *ret_program = reinterpret_cast<pi_program>(new int{1});
-  return static_cast<pi_result>(record.return_value());
-}
+  if (numDevices != nullptr) {
+    *numDevices =
+        *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
+  }
 
-pi_result piProgramBuild(pi_program program, pi_uint32 num_devices,
-                         const pi_device *device_list, const char *options,
-                         void (*pfn_notify)(pi_program program,
-                                            void *user_data),
-                         void *user_data) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  if (numEntries > 0 && devs != nullptr) {
+    setHandleArray(record, numDevices != nullptr ? 1 : 0, devs, numEntries);
+  }
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramBuild);
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piProgramGetInfo(pi_program program, pi_program_info param_name,
-                           size_t param_value_size, void *param_value,
-                           size_t *param_value_size_ret) {
+pi_result piMemBufferCreate(pi_context context, pi_mem_flags flags, size_t size,
+                            void *host_ptr, pi_mem *ret_mem,
+                            const pi_mem_properties *properties) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramGetInfo);
-
-  replayGetInfo(record, param_value, param_value_size_ret);
-
+  auto &record = getNextRecord(PiApiKind::piMemBufferCreate);
+  setHandleOutput(record, 0, ret_mem);
+  GMemContextMap[*ret_mem] = context;
+  GMappedMemory.create(*ret_mem);
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piProgramCompile(
-    pi_program program, pi_uint32 num_devices, const pi_device *device_list,
-    const char *options, pi_uint32 num_input_headers,
-    const pi_program *input_headers, const char **header_include_names,
-    void (*pfn_notify)(pi_program program, void *user_data), void *user_data) {
+pi_result piMemRetain(pi_mem mem) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramCompile);
-
+  auto &record = getNextRecord(PiApiKind::piMemRetain);
+  GMappedMemory.retain(mem);
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piProgramLink(pi_context context, pi_uint32 num_devices,
-                        const pi_device *device_list, const char *options,
-                        pi_uint32 num_input_programs,
-                        const pi_program *input_programs,
-                        void (*pfn_notify)(pi_program program, void *user_data),
-                        void *user_data, pi_program *ret_program) {
+pi_result piMemRelease(pi_mem mem) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramLink);
-
+  auto &record = getNextRecord(PiApiKind::piMemRelease);
+  GMappedMemory.release(mem);
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piProgramRetain(pi_program program) {
+pi_result piMemGetInfo(pi_mem mem, cl_mem_info param_name,
+                       size_t param_value_size, void *param_value,
+                       size_t *param_value_size_ret) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  pi_result res = replayGetInfo(
+      PiApiKind::piMemGetInfo, reinterpret_cast<uint64_t>(mem), 0, param_name,
+      param_value_size, param_value, param_value_size_ret);
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramRetain);
+  if (param_name == CL_MEM_CONTEXT && param_value &&
+      GMemContextMap.count(mem)) {
+    *static_cast<pi_context *>(param_value) = GMemContextMap[mem];
+  }
 
-  return static_cast<pi_result>(record.return_value());
+  return res;
 }
 
-pi_result piextProgramSetSpecializationConstant(pi_program prog,
-                                                pi_uint32 spec_id,
-                                                size_t spec_size,
-                                                const void *spec_value) {
+pi_result piextDeviceSelectBinary(pi_device device, pi_device_binary *binaries,
+                                  pi_uint32 num_binaries,
+                                  pi_uint32 *selected_binary_ind) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(),
-                  PiApiKind::piextProgramSetSpecializationConstant);
+  auto &record = getNextRecord(PiApiKind::piextDeviceSelectBinary);
+  *selected_binary_ind =
+      *reinterpret_cast<const pi_uint32 *>(record.small_outputs(0).data());
 
   return static_cast<pi_result>(record.return_value());
 }
@@ -419,179 +605,35 @@ pi_result piextProgramSetSpecializationConstant(pi_program prog,
 pi_result piKernelCreate(pi_program program, const char *kernel_name,
                          pi_kernel *ret_kernel) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelCreate);
-  *ret_kernel = reinterpret_cast<pi_kernel>(new int{1});
+  auto &record = getNextRecord(PiApiKind::piKernelCreate);
+  setHandleOutput(record, 0, ret_kernel);
   GKernelProgramMap[*ret_kernel] = program;
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piKernelSetExecInfo(pi_kernel kernel, pi_kernel_exec_info value_name,
-                              size_t param_value_size,
-                              const void *param_value) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelSetExecInfo);
-  return static_cast<pi_result>(record.return_value());
-}
-
 pi_result piKernelGetInfo(pi_kernel kernel, pi_kernel_info param_name,
                           size_t param_value_size, void *param_value,
                           size_t *param_value_size_ret) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelGetInfo);
+  pi_result res = replayGetInfo(
+      PiApiKind::piKernelGetInfo, reinterpret_cast<uint64_t>(kernel), 0, param_name,
+      param_value_size, param_value, param_value_size_ret);
 
-  replayGetInfo(record, param_value, param_value_size_ret);
-
-  if (param_name == PI_KERNEL_INFO_PROGRAM && param_value) {
+  if (param_name == PI_KERNEL_INFO_PROGRAM && param_value &&
+      GKernelProgramMap.count(kernel)) {
     *static_cast<pi_program *>(param_value) = GKernelProgramMap[kernel];
   }
 
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piKernelGetGroupInfo(pi_kernel kernel, pi_device device,
-                               pi_kernel_group_info param_name,
-                               size_t param_value_size, void *param_value,
-                               size_t *param_value_size_ret) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelGetGroupInfo);
-
-  replayGetInfo(record, param_value, param_value_size_ret);
-
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piextKernelSetArgMemObj(pi_kernel kernel, pi_uint32 arg_index,
-                                  const pi_mem *arg_value) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextKernelSetArgMemObj);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piKernelSetArg(pi_kernel kernel, pi_uint32 arg_index, size_t arg_size,
-                         const void *arg_value) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelSetArg);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piKernelRetain(pi_kernel kernel) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelRetain);
-  return static_cast<pi_result>(record.return_value());
-}
-
-__SYCL_EXPORT pi_result piextKernelSetArgPointer(pi_kernel kernel,
-                                                 pi_uint32 arg_index,
-                                                 size_t arg_size,
-                                                 const void *arg_value) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextKernelSetArgPointer);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piEnqueueKernelLaunch(
-    pi_queue queue, pi_kernel kernel, pi_uint32 work_dim,
-    const size_t *global_work_offset, const size_t *global_work_size,
-    const size_t *local_work_size, pi_uint32 num_events_in_wait_list,
-    const pi_event *event_wait_list, pi_event *event) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEnqueueKernelLaunch);
-  *event = reinterpret_cast<pi_event>(new int{1});
-  return static_cast<pi_result>(record.return_value());
+  return res;
 }
 
 pi_result piEnqueueMemUnmap(pi_queue command_queue, pi_mem memobj,
                             void *mapped_ptr, pi_uint32 num_events_in_wait_list,
                             const pi_event *event_wait_list, pi_event *event) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEnqueueMemUnmap);
-  *event = reinterpret_cast<pi_event>(new int{1});
-  delete[] static_cast<char *>(mapped_ptr);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piEnqueueEventsWait(pi_queue command_queue,
-                              pi_uint32 num_events_in_wait_list,
-                              const pi_event *event_wait_list,
-                              pi_event *event) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEnqueueEventsWait);
-  *event = reinterpret_cast<pi_event>(new int{1});
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piEnqueueEventsWaitWithBarrier(pi_queue command_queue,
-                                         pi_uint32 num_events_in_wait_list,
-                                         const pi_event *event_wait_list,
-                                         pi_event *event) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(),
-                  PiApiKind::piEnqueueEventsWaitWithBarrier);
-  *event = reinterpret_cast<pi_event>(new int{1});
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piEventsWait(pi_uint32 num_events, const pi_event *event_list) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEventsWait);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piEventRelease(pi_event) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEventRelease);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piMemRelease(pi_mem) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piMemRelease);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piProgramRelease(pi_program) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piProgramRelease);
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piKernelRelease(pi_kernel) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piKernelRelease);
+  auto &record = getNextRecord(PiApiKind::piEnqueueMemUnmap);
+  setHandleOutput(record, 0, event);
+  GMappedMemory.unmap(mapped_ptr);
   return static_cast<pi_result>(record.return_value());
 }
 
@@ -602,23 +644,20 @@ pi_result piEnqueueMemBufferMap(pi_queue command_queue, pi_mem buffer,
                                 const pi_event *event_wait_list,
                                 pi_event *event, void **ret_map) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
+  auto &record = getNextRecord(PiApiKind::piEnqueueMemBufferMap);
 
-  dieIfUnexpected(record.function_id(), PiApiKind::piEnqueueMemBufferMap);
-
-  std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-  std::ifstream memIS{outDir / kBuffersPath / record.mem_obj_outputs(0)};
-  size_t objSize;
-  memIS.read(reinterpret_cast<char *>(&objSize), sizeof(size_t));
-
-  auto memory = new char[objSize];
-
-  memIS.read(memory, objSize);
+  if (isFastMode()) {
+    *ret_map = GMappedMemory.map(buffer, size);
+    setHandleOutput(record, 0, event);
+    return static_cast<pi_result>(record.return_value());
+  }
 
-  memIS.close();
+  const auto &mem = getMemOutput(0);
+  char *memory = GMappedMemory.map(buffer, mem.size());
+  std::copy(mem.begin(), mem.end(), memory);
 
   *ret_map = memory;
-  *event = reinterpret_cast<pi_event>(new int{1});
+  setHandleOutput(record, 0, event);
 
   return static_cast<pi_result>(record.return_value());
 }
@@ -630,19 +669,17 @@ pi_result piEnqueueMemBufferRead(pi_queue queue, pi_mem buffer,
                                  const pi_event *event_wait_list,
                                  pi_event *event) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piEnqueueMemBufferRead);
+  auto &record = getNextRecord(PiApiKind::piEnqueueMemBufferRead);
 
-  std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-  std::ifstream memIS{outDir / kBuffersPath / record.mem_obj_outputs(0)};
-  size_t objSize;
-  memIS.read(reinterpret_cast<char *>(&objSize), sizeof(size_t));
+  if (isFastMode()) {
+    setHandleOutput(record, 0, event);
+    return static_cast<pi_result>(record.return_value());
+  }
 
-  memIS.read(static_cast<char *>(ptr), size);
-  memIS.close();
+  const auto &mem = getMemOutput(0);
+  std::copy_n(mem.begin(), std::min(size, mem.size()), static_cast<char *>(ptr));
 
-  *event = reinterpret_cast<pi_event>(new int{1});
+  setHandleOutput(record, 0, event);
 
   return static_cast<pi_result>(record.return_value());
 }
@@ -653,147 +690,66 @@ pi_result piextUSMEnqueueMemcpy(pi_queue queue, pi_bool blocking, void *dst_ptr,
                                 const pi_event *events_waitlist,
                                 pi_event *event) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextUSMEnqueueMemcpy);
-
-  if (record.mem_obj_outputs().size() > 0) {
-    std::filesystem::path outDir{std::getenv(kTracePathEnvVar)};
-    std::ifstream memIS{outDir / kBuffersPath / record.mem_obj_outputs(0)};
-    size_t objSize;
-    memIS.read(reinterpret_cast<char *>(&objSize), sizeof(size_t));
+  auto &record = getNextRecord(PiApiKind::piextUSMEnqueueMemcpy);
 
-    memIS.read(static_cast<char *>(dst_ptr), size);
-    memIS.close();
+  if (record.mem_obj_outputs().size() > 0 && !isFastMode()) {
+    const auto &mem = getMemOutput(0);
+    std::copy_n(mem.begin(), std::min(size, mem.size()),
+                static_cast<char *>(dst_ptr));
   }
 
-  *event = reinterpret_cast<pi_event>(new int{1});
-
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piextUSMHostAlloc(void **result_ptr, pi_context context,
-                            pi_usm_mem_properties *properties, size_t size,
-                            pi_uint32 alignment) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextUSMHostAlloc);
-  *result_ptr = static_cast<void *>(new char[size]);
-
-  return static_cast<pi_result>(record.return_value());
-}
-
-pi_result piextUSMDeviceAlloc(void **result_ptr, pi_context context,
-                              pi_device device,
-                              pi_usm_mem_properties *properties, size_t size,
-                              pi_uint32 alignment) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextUSMDeviceAlloc);
-  *result_ptr = static_cast<void *>(new char[size]);
+  setHandleOutput(record, 0, event);
 
   return static_cast<pi_result>(record.return_value());
 }
 
 pi_result piextUSMFree(pi_context context, void *ptr) {
   ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextUSMFree);
+  auto &record = getNextRecord(PiApiKind::piextUSMFree);
 
   delete[] static_cast<char *>(ptr);
 
   return static_cast<pi_result>(record.return_value());
 }
 
-pi_result piextUSMEnqueueMemset(pi_queue queue, void *ptr, pi_int32 value,
-                                size_t count, pi_uint32 num_events_in_waitlist,
-                                const pi_event *events_waitlist,
-                                pi_event *event) {
-  ensureTraceOpened();
-  auto record = getNextRecord(GTrace);
-
-  dieIfUnexpected(record.function_id(), PiApiKind::piextUSMEnqueueMemset);
-
-  *event = reinterpret_cast<pi_event>(new int{1});
-
-  return static_cast<pi_result>(record.return_value());
-}
-
 pi_result piTearDown(void *) {
   return PI_SUCCESS;
 }
 
 pi_result piPluginInit(pi_plugin *PluginInit) {
+#define _PI_API(api)                                                           \
+  (PluginInit->PiFunctionTable).api =                                          \
+      &GenericEntry<PiApiKind::api, decltype(&::api)>::call;
+#include <CL/sycl/detail/pi.def>
+#undef _PI_API
 
 #define _PI_CL(pi_api)                                                         \
   (PluginInit->PiFunctionTable).pi_api = (decltype(&::pi_api))(&pi_api);
 
   _PI_CL(piPlatformsGet);
-  _PI_CL(piPlatformGetInfo);
-
   _PI_CL(piDevicesGet);
-  _PI_CL(piDeviceGetInfo);
-  _PI_CL(piDeviceRetain);
-  _PI_CL(piDeviceRelease);
   _PI_CL(piextDeviceSelectBinary);
-  _PI_CL(piContextCreate);
-  _PI_CL(piContextGetInfo);
-  _PI_CL(piContextRelease);
-  _PI_CL(piContextRetain);
-
-  _PI_CL(piQueueCreate);
-  _PI_CL(piQueueGetInfo);
-  _PI_CL(piQueueRetain);
-  _PI_CL(piQueueRelease);
-  _PI_CL(piQueueFinish);
 
   _PI_CL(piMemBufferCreate);
+  _PI_CL(piMemRetain);
   _PI_CL(piMemRelease);
   _PI_CL(piMemGetInfo);
-  _PI_CL(piMemImageGetInfo);
-  _PI_CL(piMemRetain);
-
-  _PI_CL(piProgramBuild);
-  _PI_CL(piProgramCreateWithBinary);
-  _PI_CL(piProgramCreate);
-  _PI_CL(piProgramRelease);
-  _PI_CL(piProgramRetain);
-  _PI_CL(piProgramCompile);
-  _PI_CL(piProgramLink);
-  _PI_CL(piProgramGetInfo);
-  _PI_CL(piextProgramSetSpecializationConstant);
 
   _PI_CL(piKernelCreate);
-  _PI_CL(piKernelSetExecInfo);
   _PI_CL(piKernelGetInfo);
-  _PI_CL(piKernelGetGroupInfo);
-  _PI_CL(piextKernelSetArgMemObj);
-  _PI_CL(piextKernelSetArgPointer);
-  _PI_CL(piKernelSetArg);
-  _PI_CL(piKernelRelease);
-  _PI_CL(piKernelRetain);
-
-  _PI_CL(piEnqueueKernelLaunch);
+
   _PI_CL(piEnqueueMemBufferMap);
   _PI_CL(piEnqueueMemBufferRead);
   _PI_CL(piEnqueueMemUnmap);
-  _PI_CL(piEnqueueEventsWait);
-  _PI_CL(piEnqueueEventsWaitWithBarrier);
-
-  _PI_CL(piEventsWait);
-  _PI_CL(piEventRelease);
 
   _PI_CL(piextUSMEnqueueMemcpy);
-  _PI_CL(piextUSMEnqueueMemset);
-  _PI_CL(piextUSMDeviceAlloc);
-  _PI_CL(piextUSMHostAlloc);
   _PI_CL(piextUSMFree);
 
   _PI_CL(piTearDown);
 
+  if (const char *traceDir = getenv(kTracePathEnvVar))
+    GInfoIndex.build(traceDir);
+
   return PI_SUCCESS;
 }
 }
@@ -0,0 +1,109 @@
+#include "trace_reader.hpp"
+
+#include <cassert>
+#include <dlfcn.h>
+
+using setInternalThreadCreation_t = void (*)(bool);
+
+// libsystem_intercept names every new thread after its parent and the number of
+// threads the parent has started. Decoder threads must not be counted,
+// otherwise names of application threads diverge from the recorded ones.
+static void setInternalThreadCreation(bool value) {
+  static auto *fn = reinterpret_cast<setInternalThreadCreation_t>(
+      dlsym(RTLD_DEFAULT, "dpcppTraceSetInternalThreadCreation"));
+  if (fn)
+    fn(value);
+}
+
+TraceReader::TraceReader(std::filesystem::path traceFile,
+                         std::filesystem::path buffersDir, size_t lookahead,
+                         bool readMemObjects)
+    : mTrace(traceFile, std::ios::binary), mBuffersDir(std::move(buffersDir)),
+      mReadMemObjects(readMemObjects), mSlots(lookahead == 0 ? 1 : lookahead) {
+  setInternalThreadCreation(true);
+  mDecoder = std::jthread([this](std::stop_token token) { decode(token); });
+  setInternalThreadCreation(false);
+}
+
+TraceReader::~TraceReader() {
+  mDecoder.request_stop();
+  mHead.fetch_or(kStopBit, std::memory_order_release);
+  mHead.notify_one();
+}
+
+TraceReader::Record *TraceReader::peek(size_t n) {
+  assert(n < mSlots.size() && "Peeking beyond lookahead window");
+  const uint64_t idx = (mHead.load(std::memory_order_relaxed) & ~kStopBit) + n;
+
+  while (true) {
+    const uint64_t tail = mTail.load(std::memory_order_acquire);
+    if ((tail & ~kEndBit) > idx)
+      return &mSlots[idx % mSlots.size()];
+    if (tail & kEndBit)
+      return nullptr;
+    mTail.wait(tail, std::memory_order_acquire);
+  }
+}
+
+void TraceReader::pop() {
+  mHead.fetch_add(1, std::memory_order_release);
+  mHead.notify_one();
+}
+
+void TraceReader::decode(std::stop_token token) {
+  uint64_t tail = 0;
+
+  while (!token.stop_requested()) {
+    const uint64_t head = mHead.load(std::memory_order_acquire);
+    if (head & kStopBit)
+      return;
+
+    if (tail - head == mSlots.size()) {
+      mHead.wait(head, std::memory_order_acquire);
+      continue;
+    }
+
+    if (!readRecord(mSlots[tail % mSlots.size()]))
+      break;
+
+    tail++;
+    mTail.store(tail, std::memory_order_release);
+    mTail.notify_one();
+  }
+
+  mTail.store(tail | kEndBit, std::memory_order_release);
+  mTail.notify_one();
+}
+
+bool TraceReader::readRecord(Record &record) {
+  uint32_t size;
+  if (!mTrace.read(reinterpret_cast<char *>(&size), sizeof(uint32_t)))
+    return false;
+
+  // Slots and the read buffer are reused, so that steady state decoding does
+  // not allocate memory.
+  mReadBuffer.resize(size);
+  if (!mTrace.read(mReadBuffer.data(), size))
+    return false;
+
+  if (!record.call.ParseFromArray(mReadBuffer.data(), size))
+    return false;
+
+  const int numMemObjs = record.call.mem_obj_outputs_size();
+  record.memOutputs.resize(numMemObjs);
+  if (mReadMemObjects) {
+    for (int i = 0; i < numMemObjs; i++)
+      readMemObject(record.call.mem_obj_outputs(i), record.memOutputs[i]);
+  }
+
+  return true;
+}
+
+void TraceReader::readMemObject(const std::string &name,
+                                std::vector<char> &out) {
+  std::ifstream is{mBuffersDir / name, std::ios::binary};
+  size_t objSize = 0;
+  is.read(reinterpret_cast<char *>(&objSize), sizeof(size_t));
+  out.resize(objSize);
+  is.read(out.data(), objSize);
+}
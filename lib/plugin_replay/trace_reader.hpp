@@ -0,0 +1,68 @@
+#pragma once
+
+#include "api_call.pb.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes records of a single .pi_trace file on a helper thread. Decoded
+// records along with the contents of memory objects they reference are handed
+// over to the replaying thread through a bounded single-producer
+// single-consumer ring buffer, so that PI calls only pop ready records.
+class TraceReader {
+public:
+  struct Record {
+    dpcpp_trace::APICall call;
+    // Contents of files listed in call.mem_obj_outputs(), size header
+    // stripped. Empty if memory objects are not read.
+    std::vector<std::vector<char>> memOutputs;
+  };
+
+  TraceReader(std::filesystem::path traceFile,
+              std::filesystem::path buffersDir, size_t lookahead,
+              bool readMemObjects);
+  ~TraceReader();
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  // Returns the oldest decoded record, blocking until it is available.
+  // Returns nullptr if the trace is over.
+  Record *front() { return peek(0); }
+
+  // Returns the n-th oldest decoded record, n must be less than capacity().
+  // Returns nullptr if the trace ends earlier.
+  Record *peek(size_t n);
+
+  // Maximum number of records, that can be looked at without popping.
+  size_t capacity() const noexcept { return mSlots.size(); }
+
+  // Releases the oldest record, its slot is reused by the decoder.
+  void pop();
+
+private:
+  void decode(std::stop_token token);
+  bool readRecord(Record &record);
+  void readMemObject(const std::string &name, std::vector<char> &out);
+
+  // Set on tail by the decoder when there are no more records.
+  static constexpr uint64_t kEndBit = 1ull << 63;
+  // Set on head by the consumer to wake up and stop the decoder.
+  static constexpr uint64_t kStopBit = 1ull << 63;
+
+  std::ifstream mTrace;
+  std::filesystem::path mBuffersDir;
+  bool mReadMemObjects;
+  std::string mReadBuffer;
+
+  std::vector<Record> mSlots;
+  std::atomic<uint64_t> mHead = 0;
+  std::atomic<uint64_t> mTail = 0;
+
+  std::jthread mDecoder;
+};
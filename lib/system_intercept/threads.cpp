@@ -1,8 +1,14 @@
+#include "constants.hpp"
+
 #include <dlfcn.h>
 #include <pthread.h>
+#include <unistd.h>
 
-#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <string_view>
 
 using pthread_create_t = int (*)(pthread_t *, const pthread_attr_t *,
                                  void *(*)(void *), void *);
@@ -10,40 +16,146 @@ using pthread_self_t = pthread_t (*)();
 using pthread_getname_np_t = int (*)(pthread_t, char *, size_t);
 using pthread_setname_np_t = int (*)(pthread_t, const char *);
 
-thread_local size_t threadCouner = 0;
+// Threads are named after their parent and the number of threads, that the
+// parent has started before, e.g. main_0_1, and processes after the number of
+// forks of the thread, that created them, e.g. main_f0. The names are the same
+// in every run of the application and do not collide, unlike names of the
+// kernel, that are truncated to 15 characters.
+thread_local std::string GThreadName;
+thread_local size_t GThreadCounter = 0;
+thread_local size_t GForkCounter = 0;
+thread_local bool GInternalThreadCreation = false;
+
+// Threads, that were not created through pthread_create of this library, use
+// the name of the kernel.
+static const std::string &getThreadName() {
+  if (GThreadName.empty()) {
+    static auto *real_pthread_getname_np =
+        reinterpret_cast<pthread_getname_np_t>(
+            dlsym(RTLD_DEFAULT, "pthread_getname_np"));
+    static auto *real_pthread_self =
+        reinterpret_cast<pthread_self_t>(dlsym(RTLD_DEFAULT, "pthread_self"));
+
+    char buf[16] = {};
+    real_pthread_getname_np(real_pthread_self(), buf, sizeof(buf));
+    GThreadName = buf;
+  }
+  return GThreadName;
+}
+
+// Kernel names are only used by debuggers and profilers.
+static void setKernelName(pthread_t thread, const std::string &name) {
+  static auto *real_pthread_setname_np = reinterpret_cast<pthread_setname_np_t>(
+      dlsym(RTLD_DEFAULT, "pthread_setname_np"));
+  if (!real_pthread_setname_np)
+    return;
+
+  char buf[16] = {};
+  std::strncpy(buf, name.c_str(), sizeof(buf) - 1);
+  real_pthread_setname_np(thread, buf);
+}
+
+namespace {
+struct ThreadStart {
+  void *(*routine)(void *);
+  void *arg;
+  std::string name;
+};
+} // namespace
+
+static void *startThread(void *data) {
+  static auto *real_pthread_self =
+      reinterpret_cast<pthread_self_t>(dlsym(RTLD_DEFAULT, "pthread_self"));
+
+  std::unique_ptr<ThreadStart> start{static_cast<ThreadStart *>(data)};
+  GThreadName = std::move(start->name);
+  setKernelName(real_pthread_self(), GThreadName);
+  void *(*routine)(void *) = start->routine;
+  void *arg = start->arg;
+  start.reset();
+  return routine(arg);
+}
 
 extern "C" {
+// dpcpp_trace libraries call this around creation of their own helper
+// threads, so that they do not affect names of application threads.
+void dpcppTraceSetInternalThreadCreation(bool value) {
+  GInternalThreadCreation = value;
+}
+
+// Returns the name of the calling thread, that is valid until the thread exits.
+const char *dpcppTraceGetThreadName() { return getThreadName().c_str(); }
+
 int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
                    void *(*start_routine)(void *arg), void *arg) {
   static auto *real_pthread_create =
       reinterpret_cast<pthread_create_t>(dlsym(RTLD_NEXT, "pthread_create"));
-  static auto *real_pthread_self =
-      reinterpret_cast<pthread_self_t>(dlsym(RTLD_DEFAULT, "pthread_self"));
-  static auto *real_pthread_getname_np = reinterpret_cast<pthread_getname_np_t>(
-      dlsym(RTLD_DEFAULT, "pthread_getname_np"));
-  static auto *real_pthread_setname_np = reinterpret_cast<pthread_setname_np_t>(
-      dlsym(RTLD_DEFAULT, "pthread_setname_np"));
 
-  int retValue = real_pthread_create(thread, attr, start_routine, arg);
+  if (GInternalThreadCreation)
+    return real_pthread_create(thread, attr, start_routine, arg);
+
+  auto start = std::make_unique<ThreadStart>();
+  start->routine = start_routine;
+  start->arg = arg;
+  start->name = getThreadName() + "_" + std::to_string(GThreadCounter);
 
-  pthread_t self = real_pthread_self();
-  std::array<char, 1024> buf;
-  real_pthread_getname_np(self, buf.data(), buf.size());
-  std::string newName{buf.data()};
-  newName += "_" + std::to_string(threadCouner++);
+  int retValue = real_pthread_create(thread, attr, startThread, start.get());
+  if (retValue != 0)
+    return retValue;
 
-  real_pthread_setname_np(*thread, newName.c_str());
+  // The thread owns its start data.
+  start.release();
+  GThreadCounter++;
 
   return retValue;
 }
 }
+
+// Processes keep their name across exec. It is passed in the environment
+// together with the process id, since the variable is inherited by child
+// processes as well.
+static void exportProcessName() {
+  const std::string value = std::to_string(getpid()) + " " + GThreadName;
+  setenv(kProcessNameEnvVar, value.c_str(), /*overwrite*/ 1);
+}
+
+static std::string getProcessName() {
+  const char *value = std::getenv(kProcessNameEnvVar);
+  if (!value)
+    return "main";
+
+  const std::string_view view{value};
+  const size_t separator = view.find(' ');
+  if (separator == std::string_view::npos)
+    return "main";
+  const std::string_view owner = view.substr(0, separator);
+  const std::string name{view.substr(separator + 1)};
+  if (owner == std::to_string(getpid()))
+    return name;
+  // Processes, that were started without fork handlers, e.g. by posix_spawn,
+  // are named after their process id, which is not the same in every run.
+  return name + "_p" + std::to_string(getpid());
+}
+
+static void prepareFork() { GForkCounter++; }
+
+// Only the thread, that called fork, exists in the child.
+static void renameForkedThread() {
+  GThreadName = getThreadName() + "_f" + std::to_string(GForkCounter - 1);
+  GThreadCounter = 0;
+  GForkCounter = 0;
+  static auto *real_pthread_self =
+      reinterpret_cast<pthread_self_t>(dlsym(RTLD_DEFAULT, "pthread_self"));
+  setKernelName(real_pthread_self(), GThreadName);
+  exportProcessName();
+}
+
 __attribute__((constructor)) static void setMainThreadName() {
-  static auto *real_pthread_setname_np = reinterpret_cast<pthread_setname_np_t>(
-      dlsym(RTLD_DEFAULT, "pthread_setname_np"));
   static auto *real_pthread_self =
       reinterpret_cast<pthread_self_t>(dlsym(RTLD_DEFAULT, "pthread_self"));
 
-  if (real_pthread_setname_np) {
-    real_pthread_setname_np(real_pthread_self(), "main");
-  }
+  GThreadName = getProcessName();
+  setKernelName(real_pthread_self(), GThreadName);
+  exportProcessName();
+  pthread_atfork(prepareFork, nullptr, renameForkedThread);
 }
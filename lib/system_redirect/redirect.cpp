@@ -0,0 +1,213 @@
+#include "constants.hpp"
+#include "utils/RedirectTable.hpp"
+
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Redirects file accesses of packed reproducers to their packed copies from
+// within the application, so that replay does not need a tracer. Enabled by
+// setting kRedirectTableEnvVar to the absolute path of the table written by
+// pack. Replacements are relative to the directory of the table.
+//
+// dlopen is not interposed, since the loader resolves $ORIGIN and RUNPATH of
+// the caller. Libraries loaded by name are found through kRedirectLibsPath
+// instead, that replay puts first in LD_LIBRARY_PATH.
+
+using namespace dpcpp_trace;
+
+using open_t = int (*)(const char *, int, ...);
+using openat_t = int (*)(int, const char *, int, ...);
+using fopen_t = FILE *(*)(const char *, const char *);
+using stat_t = int (*)(const char *, struct stat *);
+using stat64_t = int (*)(const char *, struct stat64 *);
+using fstatat_t = int (*)(int, const char *, struct stat *, int);
+using fstatat64_t = int (*)(int, const char *, struct stat64 *, int);
+using xstat_t = int (*)(int, const char *, struct stat *);
+using xstat64_t = int (*)(int, const char *, struct stat64 *);
+
+template <typename T> static T getNext(const char *name) {
+  return reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
+}
+
+// Interposed functions may be called before constructors of this library, so
+// the table is mapped on first use. Raw syscalls are used, since open is
+// interposed.
+static std::string_view GTraceDir;
+
+static const redirect_table::View *getTable() {
+  static const redirect_table::View *table =
+      []() -> const redirect_table::View * {
+    const char *path = std::getenv(kRedirectTableEnvVar);
+    if (!path)
+      return nullptr;
+    const std::string_view pathView{path};
+    GTraceDir = pathView.substr(0, pathView.rfind('/') + 1);
+
+    const int fd = syscall(SYS_openat, AT_FDCWD, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+      return nullptr;
+
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      return nullptr;
+
+    static redirect_table::View view{data, static_cast<size_t>(st.st_size)};
+    return view.valid() ? &view : nullptr;
+  }();
+  return table;
+}
+
+static const char *redirect(const char *path) {
+  const redirect_table::View *table = getTable();
+  if (!table || !path)
+    return path;
+
+  const char *replacement = table->find(path);
+  if (!replacement)
+    return path;
+
+  // The result is only used by the interposed call on this thread.
+  thread_local char buf[PATH_MAX];
+  const size_t size = std::strlen(replacement);
+  if (GTraceDir.size() + size >= sizeof(buf))
+    return path;
+  std::memcpy(buf, GTraceDir.data(), GTraceDir.size());
+  std::memcpy(buf + GTraceDir.size(), replacement, size + 1);
+  return buf;
+}
+
+static bool needsMode(int flags) {
+  return (flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE;
+}
+
+extern "C" {
+int open(const char *path, int flags, ...) {
+  static auto *real = getNext<open_t>("open");
+  mode_t mode = 0;
+  if (needsMode(flags)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  return real(redirect(path), flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+  static auto *real = getNext<open_t>("open64");
+  mode_t mode = 0;
+  if (needsMode(flags)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  return real(redirect(path), flags, mode);
+}
+
+int openat(int dirFd, const char *path, int flags, ...) {
+  static auto *real = getNext<openat_t>("openat");
+  mode_t mode = 0;
+  if (needsMode(flags)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  return real(dirFd, redirect(path), flags, mode);
+}
+
+int openat64(int dirFd, const char *path, int flags, ...) {
+  static auto *real = getNext<openat_t>("openat64");
+  mode_t mode = 0;
+  if (needsMode(flags)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  return real(dirFd, redirect(path), flags, mode);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+  static auto *real = getNext<fopen_t>("fopen");
+  return real(redirect(path), mode);
+}
+
+FILE *fopen64(const char *path, const char *mode) {
+  static auto *real = getNext<fopen_t>("fopen64");
+  return real(redirect(path), mode);
+}
+
+int stat(const char *path, struct stat *buf) noexcept {
+  static auto *real = getNext<stat_t>("stat");
+  return real(redirect(path), buf);
+}
+
+int stat64(const char *path, struct stat64 *buf) noexcept {
+  static auto *real = getNext<stat64_t>("stat64");
+  return real(redirect(path), buf);
+}
+
+int lstat(const char *path, struct stat *buf) noexcept {
+  static auto *real = getNext<stat_t>("lstat");
+  return real(redirect(path), buf);
+}
+
+int lstat64(const char *path, struct stat64 *buf) noexcept {
+  static auto *real = getNext<stat64_t>("lstat64");
+  return real(redirect(path), buf);
+}
+
+int fstatat(int dirFd, const char *path, struct stat *buf, int flags) noexcept {
+  static auto *real = getNext<fstatat_t>("fstatat");
+  return real(dirFd, redirect(path), buf, flags);
+}
+
+int fstatat64(int dirFd, const char *path, struct stat64 *buf,
+              int flags) noexcept {
+  static auto *real = getNext<fstatat64_t>("fstatat64");
+  return real(dirFd, redirect(path), buf, flags);
+}
+
+// Binaries built against glibc older than 2.33 call these instead of stat.
+// Newer glibc only keeps them for compatibility, so they are not found by
+// dlsym, and the regular functions, that have the same layout, are used.
+int __xstat(int ver, const char *path, struct stat *buf) {
+  static auto *real = getNext<xstat_t>("__xstat");
+  static auto *fallback = getNext<stat_t>("stat");
+  return real ? real(ver, redirect(path), buf) : fallback(redirect(path), buf);
+}
+
+int __xstat64(int ver, const char *path, struct stat64 *buf) {
+  static auto *real = getNext<xstat64_t>("__xstat64");
+  static auto *fallback = getNext<stat64_t>("stat64");
+  return real ? real(ver, redirect(path), buf) : fallback(redirect(path), buf);
+}
+
+int __lxstat(int ver, const char *path, struct stat *buf) {
+  static auto *real = getNext<xstat_t>("__lxstat");
+  static auto *fallback = getNext<stat_t>("lstat");
+  return real ? real(ver, redirect(path), buf) : fallback(redirect(path), buf);
+}
+
+int __lxstat64(int ver, const char *path, struct stat64 *buf) {
+  static auto *real = getNext<xstat64_t>("__lxstat64");
+  static auto *fallback = getNext<stat64_t>("lstat64");
+  return real ? real(ver, redirect(path), buf) : fallback(redirect(path), buf);
+}
+}
@@ -0,0 +1,234 @@
+#include "utils/Archive.hpp"
+#include "utils/Hash.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+namespace dpcpp_trace {
+static constexpr std::array<char, 8> kArchiveMagic = {'D', 'P', 'C', 'T',
+                                                      'P', 'A', 'C', 'K'};
+
+struct Trailer {
+  uint64_t directoryOffset;
+  uint64_t directorySize;
+  std::array<char, 8> magic;
+};
+
+// Sums of untrusted offsets and sizes may overflow, so the range is compared
+// with the remaining space instead.
+static bool isInRange(uint64_t offset, uint64_t size, uint64_t limit) {
+  return size <= limit && offset <= limit - size;
+}
+
+namespace {
+// Bounds checked reader of little-endian archive fields.
+class Cursor {
+public:
+  Cursor(const uint8_t *begin, const uint8_t *end) : mPtr(begin), mEnd(end) {}
+
+  bool atEnd() const noexcept { return mPtr == mEnd; }
+  uint64_t offset(const uint8_t *base) const noexcept { return mPtr - base; }
+
+  template <typename T> T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string_view readString() {
+    const uint64_t size = read<uint64_t>();
+    return {reinterpret_cast<const char *>(take(size)), size};
+  }
+
+  const uint8_t *take(uint64_t size) {
+    if (static_cast<uint64_t>(mEnd - mPtr) < size)
+      throw std::runtime_error("Packed trace is corrupted");
+    const uint8_t *ptr = mPtr;
+    mPtr += size;
+    return ptr;
+  }
+
+private:
+  const uint8_t *mPtr;
+  const uint8_t *mEnd;
+};
+} // namespace
+
+template <typename T> static void write(std::ostream &os, T value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static MappedFileOptions getMappingOptions(MappedFileOptions::Access access) {
+  // Only the directory is read upfront, frames are faulted in on extraction.
+  MappedFileOptions options;
+  options.access = access;
+  return options;
+}
+
+Archive::Archive(const std::filesystem::path &path,
+                 MappedFileOptions::Access access)
+    : mMapping(path, getMappingOptions(access)) {
+  if (mMapping.begin() == mMapping.end())
+    throw std::runtime_error("Packed trace is empty");
+
+  mVersion = *mMapping.begin();
+  if (mVersion == 0)
+    parseV0();
+  else if (mVersion == 1 || mVersion == 2)
+    parseV1();
+  else
+    throw std::runtime_error("Unknown package version " +
+                             std::to_string(mVersion));
+
+  for (size_t i = 0; i < mEntries.size(); i++)
+    mIndex.emplace(mEntries[i].path, i);
+}
+
+void Archive::parseV0() {
+  Cursor cursor{mMapping.begin() + 1, mMapping.end()};
+
+  while (!cursor.atEnd()) {
+    Entry entry;
+    const uint8_t kind = cursor.read<uint8_t>();
+    entry.isDirectory = kind == 0;
+    entry.path = cursor.readString();
+
+    if (!entry.isDirectory) {
+      const uint64_t length = cursor.read<uint64_t>();
+      const uint64_t offset = cursor.offset(mMapping.begin());
+      cursor.take(length);
+      entry.frames.push_back(Frame{offset, length});
+    }
+
+    mEntries.push_back(std::move(entry));
+  }
+}
+
+void Archive::parseV1() {
+  const uint64_t archiveSize = mMapping.end() - mMapping.begin();
+  if (archiveSize < 1 + sizeof(Trailer))
+    throw std::runtime_error("Packed trace is corrupted");
+
+  Trailer trailer;
+  std::memcpy(&trailer, mMapping.end() - sizeof(Trailer), sizeof(Trailer));
+  // The directory follows the version byte.
+  if (trailer.magic != kArchiveMagic || trailer.directoryOffset < 1 ||
+      !isInRange(trailer.directoryOffset, trailer.directorySize,
+                 archiveSize - sizeof(Trailer)))
+    throw std::runtime_error("Packed trace is corrupted");
+
+  // v2 header: uint64_t dictionary size, dictionary.
+  if (mVersion >= 2) {
+    Cursor header{mMapping.begin() + 1,
+                  mMapping.begin() + trailer.directoryOffset};
+    mDictionary.size = header.read<uint64_t>();
+    mDictionary.offset = header.take(mDictionary.size) - mMapping.begin();
+  }
+
+  const uint8_t *directory = mMapping.begin() + trailer.directoryOffset;
+  Cursor cursor{directory, directory + trailer.directorySize};
+
+  const uint64_t numEntries = cursor.read<uint64_t>();
+  for (uint64_t i = 0; i < numEntries; i++) {
+    Entry entry;
+    entry.isDirectory = cursor.read<uint8_t>() == 0;
+    entry.path = cursor.readString();
+    entry.size = cursor.read<uint64_t>();
+    entry.hash = cursor.read<uint64_t>();
+    entry.mtime = cursor.read<int64_t>();
+
+    const uint64_t numFrames = cursor.read<uint64_t>();
+    for (uint64_t k = 0; k < numFrames; k++) {
+      Frame frame;
+      frame.offset = cursor.read<uint64_t>();
+      frame.size = cursor.read<uint64_t>();
+      if (!isInRange(frame.offset, frame.size, trailer.directoryOffset))
+        throw std::runtime_error("Packed trace is corrupted");
+      entry.frames.push_back(frame);
+    }
+
+    mEntries.push_back(std::move(entry));
+  }
+}
+
+bool Archive::isArchive(const std::filesystem::path &path) {
+  std::ifstream is{path, std::ios::binary};
+  char version = -1;
+  if (!is.read(&version, sizeof(char)) || version < 0 ||
+      version > kArchiveVersion)
+    return false;
+  is.close();
+
+  try {
+    Archive archive{path};
+  } catch (std::runtime_error &) {
+    return false;
+  }
+  return true;
+}
+
+const Archive::Entry *Archive::find(std::string_view path) const {
+  auto it = mIndex.find(path);
+  if (it == mIndex.end())
+    return nullptr;
+  return &mEntries[it->second];
+}
+
+void Archive::extract(const Entry &entry, std::ostream &out,
+                      Compression &comp) const {
+  // v0 files are a single frame of arbitrary size, stream it in chunks.
+  if (mVersion == 0) {
+    for (const Frame &frame : entry.frames)
+      comp.uncompress(frameData(frame), out);
+    return;
+  }
+
+  for (const Frame &frame : entry.frames)
+    mMapping.prefetch(frame.offset, frame.size);
+
+  XXHash64 hash;
+  uint64_t size = 0;
+  for (const Frame &frame : entry.frames) {
+    const Buffer buf = comp.uncompress(frameData(frame), kArchiveFrameSize);
+    hash.update(buf.data(), buf.size());
+    out.write(buf.as<char>(), buf.size());
+    size += buf.size();
+  }
+
+  if (size != entry.size || hash.digest() != entry.hash)
+    throw std::runtime_error("Checksum mismatch for " + entry.path);
+}
+
+void Archive::writeHeader(std::ostream &os, const Buffer &dictionary) {
+  write<uint8_t>(os, kArchiveVersion);
+  write<uint64_t>(os, dictionary.size());
+  os.write(dictionary.as<char>(), dictionary.size());
+}
+
+void Archive::writeDirectory(std::ostream &os,
+                             const std::vector<Entry> &entries) {
+  const uint64_t directoryOffset = os.tellp();
+
+  write<uint64_t>(os, entries.size());
+  for (const Entry &entry : entries) {
+    write<uint8_t>(os, entry.isDirectory ? 0 : 1);
+    write<uint64_t>(os, entry.path.size());
+    os.write(entry.path.data(), entry.path.size());
+    write<uint64_t>(os, entry.size);
+    write<uint64_t>(os, entry.hash);
+    write<int64_t>(os, entry.mtime);
+    write<uint64_t>(os, entry.frames.size());
+    for (const Frame &frame : entry.frames) {
+      write<uint64_t>(os, frame.offset);
+      write<uint64_t>(os, frame.size);
+    }
+  }
+
+  const uint64_t directorySize = static_cast<uint64_t>(os.tellp()) -
+                                 directoryOffset;
+  write(os, Trailer{directoryOffset, directorySize, kArchiveMagic});
+}
+} // namespace dpcpp_trace
@@ -0,0 +1,82 @@
+#include "utils/ArchiveCache.hpp"
+
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace dpcpp_trace {
+ArchiveCache::ArchiveCache(const Archive &archive, fs::path root,
+                           uint64_t capacity)
+    : mArchive(archive), mRoot(fs::absolute(root)),
+      mRootPrefix(mRoot.string() + "/"), mCapacity(capacity) {
+  mCompression.setDictionary(mArchive.dictionary());
+
+  // Directories are created upfront, so that they can be listed.
+  fs::create_directories(mRoot);
+  for (const auto &entry : mArchive.entries()) {
+    if (entry.isDirectory)
+      fs::create_directories(mRoot / entry.path);
+  }
+}
+
+ArchiveCache::~ArchiveCache() {
+  std::error_code ec;
+  fs::remove_all(mRoot, ec);
+}
+
+fs::path ArchiveCache::extract(std::string_view path, bool pinned) {
+  const Archive::Entry *entry = mArchive.find(path);
+  if (!entry || entry->isDirectory)
+    return {};
+
+  const fs::path target = mRoot / entry->path;
+
+  auto it = mFiles.find(entry->path);
+  if (it != mFiles.end()) {
+    mLRU.splice(mLRU.begin(), mLRU, it->second.lruPos);
+    return target;
+  }
+  if (fs::exists(target))
+    return target;
+
+  // Extract to a temporary name, so that a partially written file is never
+  // visible under the real one.
+  const fs::path tmpTarget = target.string() + ".part";
+  {
+    fs::create_directories(target.parent_path());
+    std::ofstream os{tmpTarget, std::ios::binary};
+    mArchive.extract(*entry, os, mCompression);
+  }
+  fs::rename(tmpTarget, target);
+
+  if (!pinned) {
+    mLRU.push_front(entry->path);
+    mFiles.emplace(entry->path, CachedFile{mLRU.begin(), entry->size});
+    mSize += entry->size;
+    evict();
+  }
+
+  return target;
+}
+
+void ArchiveCache::onAccess(std::string_view absolutePath) {
+  if (!absolutePath.starts_with(mRootPrefix))
+    return;
+  extract(absolutePath.substr(mRootPrefix.size()));
+}
+
+void ArchiveCache::evict() {
+  // The most recently extracted file is always kept.
+  while (mSize > mCapacity && mLRU.size() > 1) {
+    const std::string &path = mLRU.back();
+    auto it = mFiles.find(path);
+    mSize -= it->second.size;
+
+    std::error_code ec;
+    fs::remove(mRoot / path, ec);
+
+    mFiles.erase(it);
+    mLRU.pop_back();
+  }
+}
+} // namespace dpcpp_trace
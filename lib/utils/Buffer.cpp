@@ -0,0 +1,144 @@
+#include "utils/Buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dpcpp_trace {
+namespace detail {
+class BufferPoolImpl {
+public:
+  BufferPoolImpl(std::pmr::memory_resource *upstream, size_t maxCached)
+      : mUpstream(upstream), mMaxCached(maxCached) {}
+
+  ~BufferPoolImpl() {
+    for (auto [ptr, capacity] : mFree)
+      mUpstream->deallocate(ptr, capacity);
+  }
+
+  std::pmr::memory_resource *getUpstream() const noexcept { return mUpstream; }
+
+  // Returns the smallest cached block, that fits capacity, or a new one.
+  std::pair<uint8_t *, size_t> get(size_t capacity) {
+    {
+      std::lock_guard lock{mMutex};
+      auto best = mFree.end();
+      for (auto it = mFree.begin(); it != mFree.end(); ++it) {
+        if (it->second >= capacity &&
+            (best == mFree.end() || it->second < best->second))
+          best = it;
+      }
+      if (best != mFree.end()) {
+        auto block = *best;
+        *best = mFree.back();
+        mFree.pop_back();
+        return block;
+      }
+    }
+
+    return {static_cast<uint8_t *>(mUpstream->allocate(capacity)), capacity};
+  }
+
+  void put(uint8_t *ptr, size_t capacity) {
+    {
+      std::lock_guard lock{mMutex};
+      if (mFree.size() < mMaxCached) {
+        mFree.emplace_back(ptr, capacity);
+        return;
+      }
+    }
+    mUpstream->deallocate(ptr, capacity);
+  }
+
+private:
+  std::pmr::memory_resource *mUpstream;
+  size_t mMaxCached;
+  std::mutex mMutex;
+  std::vector<std::pair<uint8_t *, size_t>> mFree;
+};
+} // namespace detail
+
+Buffer::Buffer(size_t size) {
+  resize(size);
+}
+
+Buffer Buffer::uninitialized(size_t size, BufferPool *pool) {
+  Buffer buf;
+  if (pool) {
+    buf.mPool = pool->mImpl;
+    buf.mResource = buf.mPool->getUpstream();
+  }
+  buf.resizeUninitialized(size);
+  return buf;
+}
+
+Buffer::~Buffer() { release(); }
+
+Buffer::Buffer(Buffer &&other) noexcept
+    : mData(std::exchange(other.mData, nullptr)),
+      mSize(std::exchange(other.mSize, 0)),
+      mCapacity(std::exchange(other.mCapacity, 0)),
+      mResource(other.mResource), mPool(std::move(other.mPool)) {}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    mData = std::exchange(other.mData, nullptr);
+    mSize = std::exchange(other.mSize, 0);
+    mCapacity = std::exchange(other.mCapacity, 0);
+    mResource = other.mResource;
+    mPool = std::move(other.mPool);
+  }
+  return *this;
+}
+
+void Buffer::resize(size_t size) {
+  const size_t oldSize = mSize;
+  resizeUninitialized(size);
+  if (size > oldSize)
+    std::memset(mData + oldSize, 0, size - oldSize);
+}
+
+void Buffer::resizeUninitialized(size_t size) {
+  if (size > mCapacity)
+    grow(std::max(size, mCapacity * 2));
+  mSize = size;
+}
+
+void Buffer::grow(size_t capacity) {
+  uint8_t *data;
+  if (mPool) {
+    std::tie(data, capacity) = mPool->get(capacity);
+  } else {
+    data = static_cast<uint8_t *>(mResource->allocate(capacity));
+  }
+
+  if (mSize > 0)
+    std::memcpy(data, mData, mSize);
+
+  const size_t size = mSize;
+  release();
+  mData = data;
+  mSize = size;
+  mCapacity = capacity;
+}
+
+void Buffer::release() noexcept {
+  if (!mData)
+    return;
+
+  if (mPool)
+    mPool->put(mData, mCapacity);
+  else
+    mResource->deallocate(mData, mCapacity);
+
+  mData = nullptr;
+  mSize = 0;
+  mCapacity = 0;
+}
+
+BufferPool::BufferPool(std::pmr::memory_resource *upstream, size_t maxCached)
+    : mImpl(std::make_shared<detail::BufferPoolImpl>(upstream, maxCached)) {}
+} // namespace dpcpp_trace
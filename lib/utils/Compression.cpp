@@ -1,13 +1,16 @@
 #include "utils/Compression.hpp"
+#include "utils/MiResource.hpp"
 
-#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include <zdict.h>
 #include <zstd.h>
 
 namespace dpcpp_trace {
 namespace detail {
 class CompressionImpl {
 public:
-  CompressionImpl() {
+  explicit CompressionImpl(int level) : mLevel(level) {
     mCompContext = ZSTD_createCCtx();
     mDecContext = ZSTD_createDCtx();
   }
@@ -15,42 +18,154 @@ public:
   ~CompressionImpl() {
     ZSTD_freeCCtx(mCompContext);
     ZSTD_freeDCtx(mDecContext);
+    resetDictionary();
   }
 
   ZSTD_CCtx &getCompRef() { return *mCompContext; }
 
   ZSTD_DCtx &getDecRef() { return *mDecContext; }
 
+  int getLevel() const noexcept { return mLevel; }
+
+  BufferPool &getPool() noexcept { return mPool; }
+
+  bool hasDictionary() const noexcept { return mCompDict != nullptr; }
+
+  // Dictionaries are digested once and referenced by contexts for all
+  // following frames.
+  void setDictionary(const void *ptr, size_t size) {
+    resetDictionary();
+    if (size == 0)
+      return;
+
+    mCompDict = ZSTD_createCDict(ptr, size, mLevel);
+    mDecDict = ZSTD_createDDict(ptr, size);
+    if (!mCompDict || !mDecDict)
+      throw std::runtime_error("Failed to load zstd dictionary");
+
+    ZSTD_CCtx_refCDict(mCompContext, mCompDict);
+    ZSTD_DCtx_refDDict(mDecContext, mDecDict);
+  }
+
 private:
+  void resetDictionary() {
+    ZSTD_CCtx_refCDict(mCompContext, nullptr);
+    ZSTD_DCtx_refDDict(mDecContext, nullptr);
+    ZSTD_freeCDict(mCompDict);
+    ZSTD_freeDDict(mDecDict);
+    mCompDict = nullptr;
+    mDecDict = nullptr;
+  }
+
+  int mLevel;
   ZSTD_CCtx *mCompContext;
   ZSTD_DCtx *mDecContext;
+  ZSTD_CDict *mCompDict = nullptr;
+  ZSTD_DDict *mDecDict = nullptr;
+  // Results are usually released right after they are written out, so a
+  // handful of blocks serves all calls on this context.
+  BufferPool mPool{getMiResource()};
 };
 } // namespace detail
 
-Compression::Compression() {
-  mImpl = std::make_shared<detail::CompressionImpl>();
+static void checkError(size_t code) {
+  if (ZSTD_isError(code))
+    throw std::runtime_error(std::string("zstd error: ") +
+                             ZSTD_getErrorName(code));
+}
+
+Compression::Compression(int level) {
+  mImpl = std::make_shared<detail::CompressionImpl>(level);
 }
 
 Buffer Compression::compress(const void *ptr, size_t size) {
   const size_t maxSize = ZSTD_compressBound(size);
-  Buffer buf{maxSize};
+  Buffer buf = mImpl->getPool().acquire(maxSize);
 
-  const size_t compSize = ZSTD_compressCCtx(&mImpl->getCompRef(), buf.data(),
-                                            maxSize, ptr, size, 3);
+  // The simple API ignores referenced dictionaries.
+  const size_t compSize =
+      mImpl->hasDictionary()
+          ? ZSTD_compress2(&mImpl->getCompRef(), buf.data(), maxSize, ptr, size)
+          : ZSTD_compressCCtx(&mImpl->getCompRef(), buf.data(), maxSize, ptr,
+                              size, mImpl->getLevel());
+  checkError(compSize);
 
-  buf.resize(compSize);
+  buf.resizeUninitialized(compSize);
 
   return buf;
 }
 
-Buffer Compression::uncompress(const void *ptr, size_t size) {
-  const size_t maxSize = ZSTD_getFrameContentSize(ptr, size);
-  Buffer buf{maxSize};
+Buffer Compression::uncompress(const void *ptr, size_t size,
+                               size_t maxSize) {
+  const unsigned long long contentSize = ZSTD_getFrameContentSize(ptr, size);
+
+  // Frames are always compressed with their content size.
+  if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+      contentSize == ZSTD_CONTENTSIZE_ERROR)
+    throw std::runtime_error("Not a zstd frame");
+  if (contentSize > maxSize)
+    throw std::runtime_error("zstd frame is larger than expected");
 
-  const size_t decSize =
-      ZSTD_decompressDCtx(&mImpl->getDecRef(), buf.data(), maxSize, ptr, size);
-  assert(maxSize == decSize);
+  Buffer buf = mImpl->getPool().acquire(contentSize);
+
+  const size_t decSize = ZSTD_decompressDCtx(&mImpl->getDecRef(), buf.data(),
+                                             contentSize, ptr, size);
+  checkError(decSize);
+  if (decSize != contentSize)
+    throw std::runtime_error("zstd frame is shorter than its header tells");
 
   return buf;
 }
+
+uint64_t Compression::uncompress(const void *ptr, size_t size,
+                                 std::ostream &out) {
+  ZSTD_DCtx *ctx = &mImpl->getDecRef();
+  checkError(ZSTD_DCtx_reset(ctx, ZSTD_reset_session_only));
+
+  std::vector<char> outBuf(ZSTD_DStreamOutSize());
+  ZSTD_inBuffer input{ptr, size, 0};
+  uint64_t written = 0;
+
+  size_t ret = 0;
+  bool outputFull = false;
+  while (input.pos < input.size || outputFull) {
+    ZSTD_outBuffer output{outBuf.data(), outBuf.size(), 0};
+    ret = ZSTD_decompressStream(ctx, &output, &input);
+    checkError(ret);
+
+    out.write(outBuf.data(), output.pos);
+    written += output.pos;
+
+    outputFull = output.pos == output.size;
+  }
+
+  if (ret != 0)
+    throw std::runtime_error("Truncated zstd frame");
+
+  return written;
+}
+
+void Compression::setDictionary(const void *ptr, size_t size) {
+  mImpl->setDictionary(ptr, size);
+}
+
+Buffer Compression::trainDictionary(const std::vector<Buffer> &samples,
+                                    size_t maxSize) {
+  std::vector<uint8_t> data;
+  std::vector<size_t> sizes;
+  for (const auto &sample : samples) {
+    data.insert(data.end(), sample.data(), sample.data() + sample.size());
+    sizes.push_back(sample.size());
+  }
+
+  Buffer dict{maxSize};
+  const size_t dictSize =
+      ZDICT_trainFromBuffer(dict.data(), maxSize, data.data(), sizes.data(),
+                            static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(dictSize))
+    return Buffer{0};
+
+  dict.resize(dictSize);
+  return dict;
+}
 } // namespace dpcpp_trace
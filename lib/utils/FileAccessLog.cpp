@@ -0,0 +1,101 @@
+#include "utils/FileAccessLog.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace dpcpp_trace {
+namespace {
+constexpr char kMagic[8] = {'D', 'P', 'C', 'T', 'F', 'L', 'O', 'G'};
+constexpr uint32_t kVersion = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t numEntries;
+};
+
+constexpr uint32_t kOpened = 1;
+constexpr uint32_t kRegular = 2;
+
+struct Record {
+  uint64_t device;
+  uint64_t inode;
+  uint64_t size;
+  int64_t modificationTimeNs;
+  int32_t flags;
+  uint32_t status;
+  uint32_t pathSize;
+  uint32_t reserved;
+};
+} // namespace
+
+FileAccess &FileAccessLog::operator[](std::string_view path) {
+  if (auto it = mIndex.find(path); it != mIndex.end())
+    return mEntries[it->second];
+
+  FileAccess &entry = mEntries.emplace_back();
+  entry.path = path;
+  mIndex.emplace(entry.path, mEntries.size() - 1);
+  return entry;
+}
+
+void FileAccessLog::write(const std::filesystem::path &file) const {
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.numEntries = static_cast<uint32_t>(mEntries.size());
+
+  std::ofstream os{file, std::ios::binary | std::ios::trunc};
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const FileAccess &entry : mEntries) {
+    Record record = {};
+    record.device = entry.device;
+    record.inode = entry.inode;
+    record.size = entry.size;
+    record.modificationTimeNs = entry.modificationTimeNs;
+    record.flags = entry.flags;
+    record.status =
+        (entry.opened ? kOpened : 0) | (entry.regular ? kRegular : 0);
+    record.pathSize = static_cast<uint32_t>(entry.path.size());
+
+    os.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    os.write(entry.path.data(), entry.path.size());
+  }
+  if (!os)
+    throw std::runtime_error("Failed to write " + file.string());
+}
+
+std::vector<FileAccess>
+FileAccessLog::read(const std::filesystem::path &file) {
+  std::ifstream is{file, std::ios::binary};
+  if (!is)
+    throw std::runtime_error("Failed to open " + file.string());
+
+  Header header;
+  if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion)
+    throw std::runtime_error(file.string() + " is not a file access log");
+
+  std::vector<FileAccess> entries(header.numEntries);
+  for (FileAccess &entry : entries) {
+    Record record;
+    if (!is.read(reinterpret_cast<char *>(&record), sizeof(record)))
+      throw std::runtime_error(file.string() + " is truncated");
+
+    entry.path.resize(record.pathSize);
+    if (!is.read(entry.path.data(), record.pathSize))
+      throw std::runtime_error(file.string() + " is truncated");
+
+    entry.flags = record.flags;
+    entry.opened = (record.status & kOpened) != 0;
+    entry.regular = (record.status & kRegular) != 0;
+    entry.device = record.device;
+    entry.inode = record.inode;
+    entry.size = record.size;
+    entry.modificationTimeNs = record.modificationTimeNs;
+  }
+  return entries;
+}
+} // namespace dpcpp_trace
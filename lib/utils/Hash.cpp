@@ -0,0 +1,108 @@
+#include "utils/Hash.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace dpcpp_trace {
+static constexpr uint64_t kPrime1 = 11400714785074694791ull;
+static constexpr uint64_t kPrime2 = 14029467366897019727ull;
+static constexpr uint64_t kPrime3 = 1609587929392839161ull;
+static constexpr uint64_t kPrime4 = 9650029242287828579ull;
+static constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+static uint64_t read64(const uint8_t *ptr) {
+  uint64_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static uint32_t read32(const uint8_t *ptr) {
+  uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = std::rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+static uint64_t mergeRound(uint64_t acc, uint64_t value) {
+  acc ^= round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+
+XXHash64::XXHash64(uint64_t seed)
+    : mAcc{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1},
+      mSeed(seed) {}
+
+void XXHash64::update(const void *ptr, size_t size) {
+  const auto *data = static_cast<const uint8_t *>(ptr);
+  mTotalSize += size;
+
+  if (mBufferSize + size < mBuffer.size()) {
+    std::memcpy(mBuffer.data() + mBufferSize, data, size);
+    mBufferSize += size;
+    return;
+  }
+
+  if (mBufferSize > 0) {
+    const size_t fill = mBuffer.size() - mBufferSize;
+    std::memcpy(mBuffer.data() + mBufferSize, data, fill);
+    for (size_t i = 0; i < 4; i++)
+      mAcc[i] = round(mAcc[i], read64(mBuffer.data() + i * 8));
+    data += fill;
+    size -= fill;
+    mBufferSize = 0;
+  }
+
+  while (size >= 32) {
+    for (size_t i = 0; i < 4; i++)
+      mAcc[i] = round(mAcc[i], read64(data + i * 8));
+    data += 32;
+    size -= 32;
+  }
+
+  std::memcpy(mBuffer.data(), data, size);
+  mBufferSize = size;
+}
+
+uint64_t XXHash64::digest() const {
+  uint64_t hash;
+  if (mTotalSize >= 32) {
+    hash = std::rotl(mAcc[0], 1) + std::rotl(mAcc[1], 7) +
+           std::rotl(mAcc[2], 12) + std::rotl(mAcc[3], 18);
+    for (uint64_t acc : mAcc)
+      hash = mergeRound(hash, acc);
+  } else {
+    hash = mSeed + kPrime5;
+  }
+
+  hash += mTotalSize;
+
+  const uint8_t *ptr = mBuffer.data();
+  const uint8_t *end = ptr + mBufferSize;
+  for (; ptr + 8 <= end; ptr += 8) {
+    hash ^= round(0, read64(ptr));
+    hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (ptr + 4 <= end) {
+    hash ^= static_cast<uint64_t>(read32(ptr)) * kPrime1;
+    hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+    ptr += 4;
+  }
+  for (; ptr < end; ptr++) {
+    hash ^= *ptr * kPrime5;
+    hash = std::rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+} // namespace dpcpp_trace
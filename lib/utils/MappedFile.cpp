@@ -1,32 +1,94 @@
 #include "utils/MappedFile.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
 #include <fcntl.h>
 #include <stdexcept>
+#include <string>
 #include <sys/mman.h>
 #include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace dpcpp_trace {
-MappedFile::MappedFile(std::filesystem::path p) {
-  mSize = fs::file_size(p);
-  mFileDescriptor = open(p.c_str(), O_RDONLY, 0);
+static int getAdvice(MappedFileOptions::Access access) {
+  switch (access) {
+  case MappedFileOptions::Access::Sequential:
+    return MADV_SEQUENTIAL;
+  case MappedFileOptions::Access::Random:
+    return MADV_RANDOM;
+  default:
+    return MADV_NORMAL;
+  }
+}
+
+static size_t alignDown(size_t value, size_t alignment) {
+  return value / alignment * alignment;
+}
+
+MappedFile::MappedFile(std::filesystem::path p,
+                       const MappedFileOptions &options) {
+  const uint64_t fileSize = fs::file_size(p);
+  if (options.offset > fileSize)
+    throw std::runtime_error("Mapped range is outside of " + p.string());
+
+  mSize = options.length.value_or(fileSize - options.offset);
+  if (mSize > fileSize - options.offset)
+    throw std::runtime_error("Mapped range is outside of " + p.string());
+
+  mFileDescriptor = open(p.c_str(), O_RDONLY | O_CLOEXEC, 0);
   if (mFileDescriptor == -1)
-    throw std::runtime_error("Failed to open file");
+    throw std::runtime_error("Failed to open file " + p.string());
 
-  mPtr = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
-              mFileDescriptor, 0);
+  // mmap fails for empty ranges.
+  if (mSize == 0)
+    return;
 
-  if (mPtr == nullptr)
-    throw std::runtime_error("Failed to map file");
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  const size_t mappingOffset = alignDown(options.offset, pageSize);
+  mMappingSize = mSize + (options.offset - mappingOffset);
+
+  const int flags = MAP_PRIVATE | (options.populate ? MAP_POPULATE : 0);
+  mMapping = mmap(nullptr, mMappingSize, PROT_READ, flags, mFileDescriptor,
+                  mappingOffset);
+  if (mMapping == MAP_FAILED) {
+    const int error = errno;
+    close(mFileDescriptor);
+    throw std::runtime_error("Failed to map file " + p.string() + ": " +
+                             std::strerror(error));
+  }
+
+  mPtr = static_cast<uint8_t *>(mMapping) + (options.offset - mappingOffset);
+
+  // Advices are hints, failures do not affect correctness.
+  if (options.access != MappedFileOptions::Access::Normal)
+    madvise(mMapping, mMappingSize, getAdvice(options.access));
+  if (options.hugePages)
+    madvise(mMapping, mMappingSize, MADV_HUGEPAGE);
+  if (options.willNeed)
+    madvise(mMapping, mMappingSize, MADV_WILLNEED);
 }
 
 MappedFile::~MappedFile() {
-  munmap(mPtr, mSize);
+  if (mMapping)
+    munmap(mMapping, mMappingSize);
   close(mFileDescriptor);
 }
 
+void MappedFile::prefetch(size_t offset, size_t count) const {
+  if (offset >= mSize || count == 0)
+    return;
+  count = std::min(count, mSize - offset);
+
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  const auto start = reinterpret_cast<uintptr_t>(begin() + offset);
+  const uintptr_t alignedStart = alignDown(start, pageSize);
+  madvise(reinterpret_cast<void *>(alignedStart), start + count - alignedStart,
+          MADV_WILLNEED);
+}
+
 uint8_t *MappedFile::begin() { return static_cast<uint8_t *>(mPtr); }
 const uint8_t *MappedFile::begin() const {
   return static_cast<uint8_t *>(mPtr);
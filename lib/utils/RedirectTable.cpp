@@ -0,0 +1,92 @@
+#include "utils/RedirectTable.hpp"
+
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace dpcpp_trace {
+// Names, that a library can be requested by, e.g. libfoo.so.1.2, libfoo.so.1
+// and libfoo.so.
+static std::vector<std::string_view> getLibraryNames(std::string_view path) {
+  const std::string_view name = path.substr(path.rfind('/') + 1);
+  const size_t soPos = name.find(".so");
+  if (soPos == std::string_view::npos)
+    return {};
+
+  const size_t baseSize = soPos + 3;
+  if (baseSize != name.size() && name[baseSize] != '.')
+    return {};
+
+  std::vector<std::string_view> names{name.substr(0, baseSize)};
+  for (size_t pos = name.find('.', baseSize + 1);
+       pos != std::string_view::npos; pos = name.find('.', pos + 1))
+    names.push_back(name.substr(0, pos));
+  if (baseSize != name.size())
+    names.push_back(name);
+
+  return names;
+}
+
+void RedirectTableBuilder::add(std::string_view path,
+                               std::string_view replacement) {
+  mPaths.emplace(path, replacement);
+  for (std::string_view name : getLibraryNames(path))
+    mLibraries.emplace(name, replacement);
+}
+
+void RedirectTableBuilder::write(const std::filesystem::path &file) const {
+  using namespace redirect_table;
+
+  const auto numBuckets = [](size_t size) -> uint32_t {
+    return size == 0 ? 0 : static_cast<uint32_t>(std::bit_ceil(size * 2));
+  };
+
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.numPaths = numBuckets(mPaths.size());
+  header.numLibraries = numBuckets(mLibraries.size());
+
+  std::vector<Bucket> buckets(uint64_t{header.numPaths} + header.numLibraries);
+  // Offset 0 marks empty buckets, strings start after a padding byte.
+  std::string strings(1, '\0');
+  const uint64_t stringsOffset =
+      sizeof(Header) + buckets.size() * sizeof(Bucket);
+
+  const auto addString = [&](std::string_view str) -> uint32_t {
+    const uint64_t offset = stringsOffset + strings.size();
+    if (offset + str.size() >= UINT32_MAX)
+      throw std::runtime_error("Redirect table is too large");
+    strings.append(str);
+    strings.push_back('\0');
+    return static_cast<uint32_t>(offset);
+  };
+
+  const auto fill = [&](const auto &entries, uint32_t first, uint32_t num) {
+    for (const auto &[key, value] : entries) {
+      const uint64_t keyHash = hash(key);
+      uint64_t idx = keyHash & (num - 1);
+      while (buckets[first + idx].key != 0)
+        idx = (idx + 1) & (num - 1);
+
+      Bucket &bucket = buckets[first + idx];
+      bucket.hash = keyHash;
+      bucket.key = addString(key);
+      bucket.keySize = static_cast<uint32_t>(key.size());
+      bucket.value = addString(value);
+    }
+  };
+
+  fill(mPaths, 0, header.numPaths);
+  fill(mLibraries, header.numPaths, header.numLibraries);
+
+  std::ofstream os{file, std::ios::binary | std::ios::trunc};
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(buckets.data()),
+           buckets.size() * sizeof(Bucket));
+  os.write(strings.data(), strings.size());
+  if (!os)
+    throw std::runtime_error("Failed to write " + file.string());
+}
+} // namespace dpcpp_trace
@@ -0,0 +1,494 @@
+#include "TraceeMemory.hpp"
+#include "TracerThread.hpp"
+#include "utils.hpp"
+#include "utils/Tracer.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <mutex>
+#include <poll.h>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int installFilter() {
+  struct sock_filter filter[] = {
+      BPF_STMT(BPF_LD + BPF_W + BPF_ABS, offsetof(struct seccomp_data, nr)),
+      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_newfstatat, 0, 1),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_USER_NOTIF),
+      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_openat, 0, 1),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_USER_NOTIF),
+      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_stat, 0, 1),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_USER_NOTIF),
+      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_exit_group, 0, 1),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_USER_NOTIF),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
+  };
+  struct sock_fprog prog = {
+      .len = static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])),
+      .filter = filter,
+  };
+
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1)
+    throw std::runtime_error(strerror(errno));
+
+  const int fd = syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER,
+                         SECCOMP_FILTER_FLAG_NEW_LISTENER, &prog);
+  if (fd == -1)
+    throw std::runtime_error(strerror(errno));
+
+  return fd;
+}
+
+static void sendFd(int sock, int fd) {
+  char data = 0;
+  iovec iov{&data, 1};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  if (sendmsg(sock, &msg, 0) == -1)
+    throw std::runtime_error(strerror(errno));
+}
+
+static int receiveFd(int sock) {
+  char data = 0;
+  iovec iov{&data, 1};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) <= 0)
+    return -1;
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS)
+    return -1;
+
+  int fd;
+  std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  return fd;
+}
+
+// Replacement paths are resolved the same way the tracee would resolve them.
+static std::string resolvePath(pid_t pid, int dirFd, const std::string &path) {
+  // Paths of the tracee's own process would refer to the tracer.
+  for (std::string_view self : {"/proc/self", "/proc/thread-self"}) {
+    if (path.starts_with(self) &&
+        (path.size() == self.size() || path[self.size()] == '/'))
+      return "/proc/" + std::to_string(pid) + path.substr(self.size());
+  }
+  if (path.starts_with('/'))
+    return path;
+  if (dirFd == AT_FDCWD)
+    return "/proc/" + std::to_string(pid) + "/cwd/" + path;
+  return "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(dirFd) +
+         "/" + path;
+}
+
+namespace dpcpp_trace {
+namespace detail {
+class SeccompHandlerImpl : public OpenHandler, public StatHandler {
+public:
+  SeccompHandlerImpl(pid_t tid, int flags) : mTid(tid), mFlags(flags) {}
+
+  void replaceFilename(std::string_view newFile) const final {
+    mReplacement = newFile;
+  }
+  int pid() const final { return getTraceeProcessId(mTid); }
+  int flags() const final { return mFlags; }
+  void onReturn(std::function<void(long)> f) const final {
+    mOnReturn = std::move(f);
+  }
+
+  const std::string &getReplacement() const noexcept { return mReplacement; }
+  const std::function<void(long)> &getOnReturn() const noexcept {
+    return mOnReturn;
+  }
+
+private:
+  pid_t mTid;
+  int mFlags;
+  mutable std::string mReplacement;
+  mutable std::function<void(long)> mOnReturn;
+};
+
+class SeccompTracerImpl {
+public:
+  explicit SeccompTracerImpl(size_t numThreads)
+      : mNumThreads(numThreads == 0
+                        ? std::max(1u, std::thread::hardware_concurrency())
+                        : numThreads) {}
+
+  ~SeccompTracerImpl() {
+    // The listener is used by the loop, that must be stopped first.
+    mThread.requestStop();
+    try {
+      mThread.wait();
+    } catch (...) {
+    }
+    if (mListener != -1)
+      close(mListener);
+  }
+
+  void launch(std::string_view executable, std::span<std::string> args,
+              std::span<std::string> env) {
+    const auto toCString = [](const std::string &str) { return str.c_str(); };
+
+    std::vector<const char *> cArgs;
+    std::transform(args.begin(), args.end(), std::back_inserter(cArgs),
+                   toCString);
+    cArgs.push_back(nullptr);
+
+    std::vector<const char *> cEnv;
+    std::transform(env.begin(), env.end(), std::back_inserter(cEnv), toCString);
+    cEnv.push_back(nullptr);
+
+    fork([&]() {
+      execve(executable.data(), const_cast<char *const *>(cArgs.data()),
+             const_cast<char *const *>(cEnv.data()));
+      std::cerr << "Unexpected error while running executable: "
+                << strerror(errno) << "\n";
+      exit(EXIT_FAILURE);
+    });
+  }
+
+  // The child installs the filter and hands the listener fd over to the
+  // tracer, filters can not be installed on other processes.
+  void fork(std::function<void()> child) {
+    int socks[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks) == -1)
+      throw std::runtime_error(strerror(errno));
+
+    mPid = ::fork();
+    if (mPid == -1)
+      throw std::runtime_error(strerror(errno));
+
+    if (mPid == 0) {
+      close(socks[0]);
+      try {
+        const int listener = installFilter();
+        sendFd(socks[1], listener);
+        close(listener);
+      } catch (std::exception &e) {
+        std::cerr << "Failed to set up seccomp filter: " << e.what() << "\n";
+        _exit(EXIT_FAILURE);
+      }
+      close(socks[1]);
+      child();
+      exit(0);
+    }
+
+    close(socks[1]);
+    mListener = receiveFd(socks[0]);
+    close(socks[0]);
+
+    if (mListener == -1) {
+      waitpid(mPid, nullptr, 0);
+      throw std::runtime_error("Failed to receive seccomp listener");
+    }
+  }
+
+  void onFileOpen(SeccompTracer::onFileOpenHandler handler) {
+    mOpenFileHandler = handler;
+  }
+  void onStat(SeccompTracer::onStatHandler handler) { mStatHandler = handler; }
+
+  void start() {
+    mThread.run([this](std::stop_token t) {
+      // Stopping kills the application, the loop exits once it is reaped.
+      std::stop_callback onStop{t, [this] { kill(); }};
+      run();
+    });
+  }
+
+  int wait() {
+    mThread.wait();
+    return mExitCode;
+  }
+  bool waitFor(std::chrono::milliseconds timeout) {
+    return mThread.waitFor(timeout);
+  }
+  // Children are not waited for, so they are killed as well.
+  void kill() {
+    if (mPid <= 0)
+      return;
+    for (pid_t pid : getProcessTree(mPid))
+      ::kill(pid, SIGKILL);
+  }
+  void interrupt() {
+    if (mPid > 0)
+      ::kill(mPid, SIGINT);
+  }
+
+private:
+  void run() {
+    mStopFd = eventfd(0, EFD_CLOEXEC);
+    if (mStopFd == -1)
+      throw std::runtime_error(strerror(errno));
+
+    std::vector<std::jthread> workers;
+    for (size_t i = 0; i < mNumThreads; i++)
+      workers.emplace_back([this] { work(); });
+    std::jthread receiver{[this] { receive(); }};
+
+    int status = 0;
+    while (waitpid(mPid, &status, 0) == -1 && errno == EINTR)
+      ;
+    if (WIFEXITED(status))
+      mExitCode = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+      mExitCode = WTERMSIG(status);
+
+    const uint64_t one = 1;
+    if (write(mStopFd, &one, sizeof(one)) == -1)
+      throw std::runtime_error(strerror(errno));
+    receiver.join();
+    {
+      std::lock_guard lock{mMutex};
+      mStopped = true;
+    }
+    mCondVar.notify_all();
+    workers.clear();
+
+    close(mStopFd);
+    mStopFd = -1;
+  }
+
+  // Only one thread receives notifications, since a receive blocks until
+  // the next notification arrives. Handling is spread over workers.
+  void receive() {
+    pollfd fds[2] = {{mListener, POLLIN, 0}, {mStopFd, POLLIN, 0}};
+    while (true) {
+      if (poll(fds, 2, -1) == -1) {
+        if (errno == EINTR)
+          continue;
+        return;
+      }
+      if (fds[1].revents != 0 || (fds[0].revents & POLLIN) == 0)
+        return;
+
+      seccomp_notif req;
+      std::memset(&req, 0, sizeof(req));
+      // Fails if the tracee was killed after the notification was sent.
+      if (ioctl(mListener, SECCOMP_IOCTL_NOTIF_RECV, &req) == -1)
+        continue;
+
+      {
+        std::lock_guard lock{mMutex};
+        mQueue.push_back(req);
+      }
+      mCondVar.notify_one();
+    }
+  }
+
+  void work() {
+    while (true) {
+      seccomp_notif req;
+      {
+        std::unique_lock lock{mMutex};
+        mCondVar.wait(lock, [this] { return mStopped || !mQueue.empty(); });
+        if (mQueue.empty())
+          return;
+        req = mQueue.front();
+        mQueue.pop_front();
+      }
+      handle(req);
+    }
+  }
+
+  void handle(const seccomp_notif &req) {
+    seccomp_notif_resp resp;
+    std::memset(&resp, 0, sizeof(resp));
+    resp.id = req.id;
+    resp.flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+
+    if (req.data.nr == __NR_exit_group) {
+      if (getTraceeProcessId(req.pid) == mPid)
+        killBackground();
+      ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+      return;
+    }
+
+    const bool isOpen = req.data.nr == __NR_openat;
+    const bool isStat = req.data.nr == __NR_stat;
+    const int dirFd = isStat ? AT_FDCWD : static_cast<int>(req.data.args[0]);
+    const uint64_t pathAddr = req.data.args[isStat ? 0 : 1];
+
+    // The id is validated after the path is read, so that the path is known
+    // to come from the tracee and not from a process, that reused its pid.
+    std::string filename;
+    if (!readTraceeString(req.pid, pathAddr, filename) ||
+        ioctl(mListener, SECCOMP_IOCTL_NOTIF_ID_VALID, &req.id) == -1) {
+      ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+      return;
+    }
+
+    const int flags = isOpen ? static_cast<int>(req.data.args[2]) : 0;
+    SeccompHandlerImpl handler{static_cast<pid_t>(req.pid), flags};
+    if (isOpen)
+      mOpenFileHandler(filename, handler);
+    else
+      mStatHandler(filename, handler);
+
+    // Only redirected calls are made by the tracer. Others are continued, so
+    // that they are made with the tracee's credentials, umask and mounts, and
+    // their results are not reported.
+    if (handler.getReplacement().empty()) {
+      ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+      return;
+    }
+
+    const std::string path =
+        resolvePath(req.pid, dirFd, handler.getReplacement());
+    resp.flags = 0;
+    if (isOpen) {
+      const long result = openFor(req, path, resp);
+      if (handler.getOnReturn())
+        handler.getOnReturn()(result);
+    } else {
+      statFor(req, path, resp);
+    }
+  }
+
+  // Processes, that the application leaves running in background, are killed
+  // when it exits. Their calls would fail once the listener is closed, and
+  // they can only be found, while the application is their ancestor.
+  void killBackground() {
+    for (pid_t pid : getProcessTree(mPid)) {
+      if (pid != mPid)
+        ::kill(pid, SIGKILL);
+    }
+  }
+
+  // Opens the file and installs it into the tracee as the result of the call.
+  // Returns the file descriptor of the tracee or -errno.
+  long openFor(const seccomp_notif &req, const std::string &path,
+               seccomp_notif_resp &resp) {
+    const int flags = static_cast<int>(req.data.args[2]);
+    const mode_t mode = static_cast<mode_t>(req.data.args[3]);
+
+    const int fd = open(path.c_str(), flags | O_CLOEXEC, mode);
+    if (fd == -1) {
+      resp.error = -errno;
+      ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+      return resp.error;
+    }
+
+    seccomp_notif_addfd addfd;
+    std::memset(&addfd, 0, sizeof(addfd));
+    addfd.id = req.id;
+    addfd.flags = SECCOMP_ADDFD_FLAG_SEND;
+    addfd.srcfd = fd;
+    addfd.newfd_flags = flags & O_CLOEXEC;
+
+    long result = ioctl(mListener, SECCOMP_IOCTL_NOTIF_ADDFD, &addfd);
+    if (result == -1) {
+      // The tracee is gone, if the notification is not valid anymore.
+      result = -errno;
+      if (errno != ENOENT) {
+        resp.error = -errno;
+        ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+      }
+    }
+    close(fd);
+    return result;
+  }
+
+  // Stat buffer is filled in by the tracer, the tracee does not make the call.
+  void statFor(const seccomp_notif &req, const std::string &path,
+               seccomp_notif_resp &resp) {
+    const bool isStat = req.data.nr == __NR_stat;
+    const uint64_t bufAddr = req.data.args[isStat ? 1 : 2];
+    const int flags = isStat ? 0 : static_cast<int>(req.data.args[3]);
+
+    struct stat st;
+    if (fstatat(AT_FDCWD, path.c_str(), &st,
+                flags & (AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT)) == -1)
+      resp.error = -errno;
+    else if (!writeTraceeMemory(req.pid, bufAddr, &st, sizeof(st)))
+      resp.error = -EFAULT;
+
+    ioctl(mListener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+  }
+
+  size_t mNumThreads;
+  pid_t mPid = -1;
+  int mListener = -1;
+  int mStopFd = -1;
+  int mExitCode = 0;
+
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  std::deque<seccomp_notif> mQueue;
+  bool mStopped = false;
+
+  SeccompTracer::onFileOpenHandler mOpenFileHandler =
+      [](std::string_view, const OpenHandler &) {};
+  SeccompTracer::onStatHandler mStatHandler = [](std::string_view,
+                                                 const StatHandler &) {};
+
+  TracerThread mThread;
+};
+} // namespace detail
+
+SeccompTracer::SeccompTracer(size_t numThreads) {
+  mImpl = std::make_shared<detail::SeccompTracerImpl>(numThreads);
+}
+
+void SeccompTracer::launch(std::string_view executable,
+                           std::span<std::string> args,
+                           std::span<std::string> env) {
+  mImpl->launch(executable, args, env);
+}
+
+void SeccompTracer::fork(std::function<void()> child) { mImpl->fork(child); }
+
+void SeccompTracer::onFileOpen(SeccompTracer::onFileOpenHandler handler) {
+  mImpl->onFileOpen(handler);
+}
+void SeccompTracer::onStat(SeccompTracer::onStatHandler handler) {
+  mImpl->onStat(handler);
+}
+void SeccompTracer::onIO(SeccompTracer::onIOHandler) {
+  throw std::runtime_error("I/O profiling requires the native tracer");
+}
+
+void SeccompTracer::start() { mImpl->start(); }
+int SeccompTracer::wait() { return mImpl->wait(); }
+bool SeccompTracer::waitFor(std::chrono::milliseconds timeout) {
+  return mImpl->waitFor(timeout);
+}
+void SeccompTracer::kill() { mImpl->kill(); }
+void SeccompTracer::interrupt() { mImpl->interrupt(); }
+} // namespace dpcpp_trace
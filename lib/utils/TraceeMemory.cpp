@@ -0,0 +1,59 @@
+#include "TraceeMemory.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <linux/limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace dpcpp_trace::detail {
+bool readTraceeMemory(pid_t pid, std::uintptr_t addr, void *buf, size_t size) {
+  iovec local{buf, size};
+  iovec remote{reinterpret_cast<void *>(addr), size};
+  return process_vm_readv(pid, &local, 1, &remote, 1, 0) ==
+         static_cast<ssize_t>(size);
+}
+
+bool writeTraceeMemory(pid_t pid, std::uintptr_t addr, const void *buf,
+                       size_t size) {
+  iovec local{const_cast<void *>(buf), size};
+  iovec remote{reinterpret_cast<void *>(addr), size};
+  return process_vm_writev(pid, &local, 1, &remote, 1, 0) ==
+         static_cast<ssize_t>(size);
+}
+
+bool readTraceeString(pid_t pid, std::uintptr_t addr, std::string &result) {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+  std::array<char, PATH_MAX> buf;
+  result.clear();
+
+  while (true) {
+    const size_t size = std::min(pageSize - addr % pageSize, buf.size());
+    if (!readTraceeMemory(pid, addr, buf.data(), size))
+      return false;
+
+    const auto *end =
+        static_cast<const char *>(std::memchr(buf.data(), 0, size));
+    if (end) {
+      result.append(buf.data(), end - buf.data());
+      return true;
+    }
+
+    result.append(buf.data(), size);
+    addr += size;
+  }
+}
+
+pid_t getTraceeProcessId(pid_t tid) {
+  std::ifstream is{"/proc/" + std::to_string(tid) + "/status"};
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.starts_with("Tgid:"))
+      return std::stoi(line.substr(5));
+  }
+  return tid;
+}
+} // namespace dpcpp_trace::detail
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+namespace dpcpp_trace::detail {
+// Copy memory of a traced process with a single syscall. Return false unless
+// the whole range is accessible.
+bool readTraceeMemory(pid_t pid, std::uintptr_t addr, void *buf, size_t size);
+bool writeTraceeMemory(pid_t pid, std::uintptr_t addr, const void *buf,
+                       size_t size);
+
+// Reads a page at a time, so that strings, that end right before an unmapped
+// page, are read as well.
+bool readTraceeString(pid_t pid, std::uintptr_t addr, std::string &result);
+
+// Returns id of the process, that thread tid belongs to, or tid if the thread
+// is gone.
+pid_t getTraceeProcessId(pid_t tid);
+} // namespace dpcpp_trace::detail
@@ -1,17 +1,23 @@
 #include "utils/Tracer.hpp"
+#include "TraceeMemory.hpp"
+#include "TracerThread.hpp"
 
 #include <asm/unistd_64.h>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <fmt/core.h>
+#include <future>
 #include <iostream>
 #include <linux/filter.h>
 #include <linux/limits.h>
 #include <linux/seccomp.h>
+#include <mutex>
 #include <stdexcept>
 #include <stop_token>
 #include <sys/prctl.h>
+#include <sys/mman.h>
 #include <sys/ptrace.h>
 #include <sys/reg.h>
 #include <sys/syscall.h>
@@ -21,6 +27,8 @@
 #include <syscall.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace std::string_literals;
 
@@ -82,21 +90,42 @@ static WaitResult wait(pid_t pid) {
   return {WaitResult::ResultType::fail, 0, status};
 }
 
-static void traceMe() {
-  struct sock_filter filter[] = {
+#define TRACE_SYSCALL(nr)                                                      \
+  BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, nr, 0, 1),                               \
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_TRACE)
+
+// I/O calls are frequent, so they only stop the application, when they are
+// profiled.
+static void traceMe(bool traceIO) {
+  struct sock_filter fileFilter[] = {
+      BPF_STMT(BPF_LD + BPF_W + BPF_ABS, offsetof(struct seccomp_data, nr)),
+      TRACE_SYSCALL(__NR_newfstatat),
+      TRACE_SYSCALL(__NR_openat),
+      TRACE_SYSCALL(__NR_stat),
+      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
+  };
+  struct sock_filter ioFilter[] = {
       BPF_STMT(BPF_LD + BPF_W + BPF_ABS, offsetof(struct seccomp_data, nr)),
-      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_newfstatat, 0, 1),
-      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_TRACE),
-      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_openat, 0, 1),
-      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_TRACE),
-      BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_stat, 0, 1),
-      BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_TRACE),
+      TRACE_SYSCALL(__NR_newfstatat),
+      TRACE_SYSCALL(__NR_openat),
+      TRACE_SYSCALL(__NR_stat),
+      TRACE_SYSCALL(__NR_read),
+      TRACE_SYSCALL(__NR_write),
+      TRACE_SYSCALL(__NR_pread64),
+      TRACE_SYSCALL(__NR_mmap),
+      TRACE_SYSCALL(__NR_close),
       BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
   };
   struct sock_fprog prog = {
-      .len = static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])),
-      .filter = filter,
+      .len = static_cast<unsigned short>(sizeof(fileFilter) /
+                                         sizeof(fileFilter[0])),
+      .filter = fileFilter,
   };
+  if (traceIO) {
+    prog.len = static_cast<unsigned short>(sizeof(ioFilter) /
+                                           sizeof(ioFilter[0]));
+    prog.filter = ioFilter;
+  }
 
   ptrace(PTRACE_TRACEME, 0, 0, 0);
 
@@ -110,7 +139,8 @@ static void traceMe() {
   kill(getpid(), SIGSTOP);
 }
 
-static std::string readString(pid_t pid, std::uintptr_t addr) {
+// Fallback for kernels without process_vm_readv, reads one word per syscall.
+static std::string peekString(pid_t pid, std::uintptr_t addr) {
   constexpr size_t longSize = sizeof(long);
 
   union ptraceData {
@@ -145,15 +175,14 @@ static std::string readString(pid_t pid, std::uintptr_t addr) {
   return result;
 }
 
-static void writeString(pid_t pid, std::uintptr_t reg, std::string_view str) {
-  char *stackAddr, *fileAddr;
-
-  stackAddr = reinterpret_cast<char *>(
-      ptrace(PTRACE_PEEKUSER, pid, sizeof(long) * RSP, nullptr));
-  stackAddr -= 128 + PATH_MAX;
-
-  fileAddr = stackAddr;
+static std::string readString(pid_t pid, std::uintptr_t addr) {
+  std::string result;
+  if (!dpcpp_trace::detail::readTraceeString(pid, addr, result))
+    return peekString(pid, addr);
+  return result;
+}
 
+static void pokeString(pid_t pid, char *stackAddr, std::string_view str) {
   bool end = false;
   size_t offset = 0;
   while (!end) {
@@ -176,6 +205,23 @@ static void writeString(pid_t pid, std::uintptr_t reg, std::string_view str) {
     stackAddr += sizeof(long);
     offset += sizeof(long);
   }
+}
+
+static void writeString(pid_t pid, std::uintptr_t reg, std::string_view str) {
+  char *stackAddr, *fileAddr;
+
+  stackAddr = reinterpret_cast<char *>(
+      ptrace(PTRACE_PEEKUSER, pid, sizeof(long) * RSP, nullptr));
+  stackAddr -= 128 + PATH_MAX;
+
+  fileAddr = stackAddr;
+
+  std::string data{str};
+  data.push_back('\0');
+  if (!dpcpp_trace::detail::writeTraceeMemory(
+          pid, reinterpret_cast<std::uintptr_t>(fileAddr), data.data(),
+          data.size()))
+    pokeString(pid, stackAddr, str);
 
   ptrace(PTRACE_POKEUSER, pid, reg, fileAddr);
 }
@@ -183,17 +229,28 @@ static void writeString(pid_t pid, std::uintptr_t reg, std::string_view str) {
 namespace dpcpp_trace {
 namespace detail {
 
+using ReturnHandlers = std::unordered_map<pid_t, std::function<void(long)>>;
+
 class OpenHandlerImpl : public OpenHandler {
 public:
-  OpenHandlerImpl(pid_t p, unsigned long fileNameReg)
-      : mPid(p), mFileNameRegister(fileNameReg) {}
+  OpenHandlerImpl(pid_t p, unsigned long fileNameReg, int flags,
+                  ReturnHandlers &returnHandlers)
+      : mPid(p), mFileNameRegister(fileNameReg), mFlags(flags),
+        mReturnHandlers(returnHandlers) {}
   void replaceFilename(std::string_view newFile) const final {
     writeString(mPid, mFileNameRegister, newFile);
   }
+  int pid() const final { return getTraceeProcessId(mPid); }
+  int flags() const final { return mFlags; }
+  void onReturn(std::function<void(long)> f) const final {
+    mReturnHandlers[mPid] = std::move(f);
+  }
 
 private:
   pid_t mPid;
   unsigned long mFileNameRegister;
+  int mFlags;
+  ReturnHandlers &mReturnHandlers;
 };
 
 class StatHandlerImpl : public StatHandler {
@@ -203,12 +260,45 @@ public:
   void replaceFilename(std::string_view newFile) const final {
     writeString(mPid, mFileNameRegister, newFile);
   }
+  int pid() const final { return getTraceeProcessId(mPid); }
 
 private:
   pid_t mPid;
   unsigned long mFileNameRegister;
 };
 
+// Thread group ids of tasks. Looking them up in /proc for every I/O call would
+// double the cost of tracing it.
+using ProcessIds = std::unordered_map<pid_t, pid_t>;
+
+class IOHandlerImpl : public IOHandler {
+public:
+  IOHandlerImpl(pid_t p, Kind kind, int fd, size_t size,
+                ReturnHandlers &returnHandlers, ProcessIds &processIds)
+      : mPid(p), mKind(kind), mFd(fd), mSize(size),
+        mReturnHandlers(returnHandlers), mProcessIds(processIds) {}
+  Kind kind() const final { return mKind; }
+  int fd() const final { return mFd; }
+  size_t size() const final { return mSize; }
+  int pid() const final {
+    auto [it, inserted] = mProcessIds.try_emplace(mPid, 0);
+    if (inserted)
+      it->second = getTraceeProcessId(mPid);
+    return it->second;
+  }
+  void onReturn(std::function<void(long)> f) const final {
+    mReturnHandlers[mPid] = std::move(f);
+  }
+
+private:
+  pid_t mPid;
+  Kind mKind;
+  int mFd;
+  size_t mSize;
+  ReturnHandlers &mReturnHandlers;
+  ProcessIds &mProcessIds;
+};
+
 class NativeTracerImpl {
 public:
   NativeTracerImpl() = default;
@@ -242,108 +332,296 @@ public:
     fork(std::move(start));
   }
 
+  // ptrace requests are only accepted from the thread, that attached to the
+  // tracee, so the child is forked by the thread, that runs the event loop.
   void fork(std::function<void()> child) {
-    pid_t pidValue = ::fork();
-    if (pidValue == 0) {
-      traceMe();
-      child();
-      exit(0);
-    } else {
-      if (auto res = ::wait(pidValue); res != true) {
-        if (res.getType() == WaitResult::ResultType::fail)
-          throw std::runtime_error(strerror(errno));
-        else {
-          throw std::runtime_error("Process immediately exited");
-        }
+    std::promise<void> attached;
+    std::future<void> attachedFuture = attached.get_future();
+
+    mThread.run([this, child = std::move(child),
+                 attached = std::move(attached)](std::stop_token t) mutable {
+      pid_t pid = -1;
+      try {
+        pid = attach(child);
+        attached.set_value();
+      } catch (...) {
+        attached.set_exception(std::current_exception());
+        return;
       }
 
-      const auto setopt = [=](long opt) {
-        if (ptrace(PTRACE_SETOPTIONS, pidValue, 0, opt) == -1) {
-          throw std::runtime_error(
-              fmt::format("Failed to set option {}: {}", opt, strerror(errno)));
-        }
-      };
-
-      setopt(PTRACE_O_TRACESECCOMP);
-
-      mWorker = [=, this](std::stop_token) {
-        while (true) {
-          if (ptrace(PTRACE_CONT, pidValue, 0, 0) == -1) {
-            throw std::runtime_error(std::string("Failed to continue tracee ") +
-                                     strerror(errno));
-          }
-          auto res = ::wait(pidValue);
-          if (res != true) {
-            if (res.getType() == WaitResult::ResultType::fail)
-              throw std::runtime_error(strerror(errno));
-            else {
-              mExitCode = res.getCode();
-              return;
-            }
-          }
-          if (!res.isSeccomp())
-            continue;
-
-          struct user_regs_struct regs;
-          if (ptrace(PTRACE_GETREGS, pidValue, 0, &regs) == -1)
-            throw std::runtime_error(strerror(errno));
-
-          long call =
-              ptrace(PTRACE_PEEKUSER, pidValue, sizeof(long) * ORIG_RAX, 0);
-
-          switch (call) {
-          case __NR_stat: {
-            StatHandlerImpl handler{pidValue, sizeof(long) * RDI};
-            std::string filename = readString(pidValue, regs.rdi);
-            mStatHandler(filename, handler);
-            break;
-          }
-          case __NR_newfstatat: {
-            StatHandlerImpl handler{pidValue, sizeof(long) * RSI};
-            std::string filename = readString(pidValue, regs.rsi);
-            mStatHandler(filename, handler);
-            break;
-          }
-          case __NR_openat: {
-            OpenHandlerImpl handler{pidValue, sizeof(long) * RSI};
-            std::string filename = readString(pidValue, regs.rsi);
-            mOpenFileHandler(filename, handler);
-            break;
-          }
-          default:
-            break;
-          }
-        }
-      };
-    }
+      // Stopping kills the application, the loop exits once all tasks are
+      // reaped.
+      std::stop_callback onStop{t, [this] { kill(); }};
+      {
+        std::unique_lock lock{mMutex};
+        mStartCondVar.wait(lock, t, [this] { return mStarted; });
+      }
+      loop(pid);
+    });
+
+    attachedFuture.get();
   }
 
   void start() {
-    std::stop_token t;
-    if (mWorker)
-      mWorker(t);
+    {
+      std::lock_guard lock{mMutex};
+      mStarted = true;
+    }
+    mStartCondVar.notify_all();
   }
 
   void onFileOpen(NativeTracer::onFileOpenHandler handler) {
     mOpenFileHandler = handler;
   }
   void onStat(NativeTracer::onStatHandler handler) { mStatHandler = handler; }
+  void onIO(NativeTracer::onIOHandler handler) { mIOHandler = handler; }
 
   int wait() {
+    mThread.wait();
     return mExitCode;
   }
-  void kill() {}
-  void interrupt() {}
+  bool waitFor(std::chrono::milliseconds timeout) {
+    return mThread.waitFor(timeout);
+  }
+
+  // Threads are killed together with their process.
+  void kill() {
+    std::lock_guard lock{mMutex};
+    mKilled = true;
+    for (pid_t task : mTasks)
+      ::kill(task, SIGKILL);
+  }
+  void interrupt() {
+    std::lock_guard lock{mMutex};
+    if (mPid > 0)
+      ::kill(mPid, SIGINT);
+  }
 
 private:
+  pid_t attach(const std::function<void()> &child) {
+    pid_t pidValue = ::fork();
+    if (pidValue == -1)
+      throw std::runtime_error(strerror(errno));
+    if (pidValue == 0) {
+      traceMe(static_cast<bool>(mIOHandler));
+      child();
+      exit(0);
+    }
+
+    if (auto res = ::wait(pidValue); res != true) {
+      if (res.getType() == WaitResult::ResultType::fail)
+        throw std::runtime_error(strerror(errno));
+      else {
+        throw std::runtime_error("Process immediately exited");
+      }
+    }
+
+    const auto setopt = [=](long opt) {
+      if (ptrace(PTRACE_SETOPTIONS, pidValue, 0, opt) == -1) {
+        throw std::runtime_error(
+            fmt::format("Failed to set option {}: {}", opt, strerror(errno)));
+      }
+    };
+
+    // Children and threads are attached automatically, so that files
+    // opened by any process of the application are seen.
+    setopt(PTRACE_O_TRACESECCOMP | PTRACE_O_TRACECLONE | PTRACE_O_TRACEFORK |
+           PTRACE_O_TRACEVFORK | PTRACE_O_TRACEEXEC | PTRACE_O_TRACESYSGOOD);
+
+    std::lock_guard lock{mMutex};
+    mPid = pidValue;
+    mTasks.insert(pidValue);
+    return pidValue;
+  }
+
+  void loop(pid_t pidValue) {
+    resume(pidValue, 0);
+    while (true) {
+      int status = 0;
+      // Only the application and its tasks are waited for, children of other
+      // threads of the tracer are left to them.
+      const pid_t pid = waitpid(-1, &status, __WALL | __WNOTHREAD);
+      if (pid == -1) {
+        if (errno == EINTR)
+          continue;
+        if (errno == ECHILD)
+          return;
+        throw std::runtime_error(strerror(errno));
+      }
+
+      if (WIFEXITED(status) || WIFSIGNALED(status)) {
+        if (pid == pidValue) {
+          mExitCode =
+              WIFEXITED(status) ? WEXITSTATUS(status) : WTERMSIG(status);
+          // Processes, that the application left running in background, can
+          // not run without the tracer, as their traced system calls would
+          // fail, so they are killed together with it.
+          kill();
+        }
+        mReturnHandlers.erase(pid);
+        mProcessIds.erase(pid);
+        std::lock_guard lock{mMutex};
+        mTasks.erase(pid);
+        continue;
+      }
+      if (!WIFSTOPPED(status))
+        continue;
+      // Tasks, that were created while the application was being killed.
+      if (isKilled())
+        ::kill(pid, SIGKILL);
+
+      int signal = 0;
+      switch (status >> 16) {
+      case PTRACE_EVENT_SECCOMP:
+        handleSyscall(pid);
+        break;
+      case PTRACE_EVENT_EXEC: {
+        // Thread, that called exec, takes over the thread group leader's
+        // id.
+        unsigned long formerId = 0;
+        ptrace(PTRACE_GETEVENTMSG, pid, 0, &formerId);
+        mReturnHandlers.erase(static_cast<pid_t>(formerId));
+        mProcessIds.erase(static_cast<pid_t>(formerId));
+        std::lock_guard lock{mMutex};
+        mTasks.erase(static_cast<pid_t>(formerId));
+        mTasks.insert(pid);
+        break;
+      }
+      case 0:
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+          handleReturn(pid);
+        } else if (WSTOPSIG(status) != SIGSTOP || !addTask(pid)) {
+          signal = WSTOPSIG(status);
+        }
+        break;
+      default:
+        // New tasks report their own stops.
+        break;
+      }
+
+      resume(pid, signal);
+    }
+  }
+
+  // New tasks start with a SIGSTOP, that must not be delivered to them.
+  // Returns false if the task is already known.
+  bool addTask(pid_t pid) {
+    std::lock_guard lock{mMutex};
+    return mTasks.insert(pid).second;
+  }
+
+  bool isKilled() {
+    std::lock_guard lock{mMutex};
+    return mKilled;
+  }
+
+  void resume(pid_t pid, int signal) {
+    // Syscall exit stop follows the seccomp stop of the call, whose result is
+    // requested.
+    const auto request =
+        mReturnHandlers.contains(pid) ? PTRACE_SYSCALL : PTRACE_CONT;
+    // Tasks may be killed at any moment, e.g. by exit_group of their process.
+    if (ptrace(request, pid, 0, signal) == -1 && errno != ESRCH) {
+      throw std::runtime_error(std::string("Failed to continue tracee ") +
+                               strerror(errno));
+    }
+  }
+
+  void handleSyscall(pid_t pid) {
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, 0, &regs) == -1) {
+      if (errno == ESRCH)
+        return;
+      throw std::runtime_error(strerror(errno));
+    }
+
+    switch (regs.orig_rax) {
+    case __NR_stat: {
+      StatHandlerImpl handler{pid, sizeof(long) * RDI};
+      std::string filename = readString(pid, regs.rdi);
+      mStatHandler(filename, handler);
+      break;
+    }
+    case __NR_newfstatat: {
+      StatHandlerImpl handler{pid, sizeof(long) * RSI};
+      std::string filename = readString(pid, regs.rsi);
+      mStatHandler(filename, handler);
+      break;
+    }
+    case __NR_openat: {
+      OpenHandlerImpl handler{pid, sizeof(long) * RSI,
+                              static_cast<int>(regs.rdx), mReturnHandlers};
+      std::string filename = readString(pid, regs.rsi);
+      mOpenFileHandler(filename, handler);
+      break;
+    }
+    case __NR_read:
+    case __NR_pread64:
+      handleIO(pid, IOHandler::Kind::Read, regs.rdi, regs.rdx);
+      break;
+    case __NR_write:
+      handleIO(pid, IOHandler::Kind::Write, regs.rdi, regs.rdx);
+      break;
+    case __NR_mmap:
+      // Anonymous mappings have no file.
+      if ((regs.r10 & MAP_ANONYMOUS) == 0)
+        handleIO(pid, IOHandler::Kind::MMap, regs.r8, regs.rsi);
+      break;
+    case __NR_close:
+      handleIO(pid, IOHandler::Kind::Close, regs.rdi, 0);
+      break;
+    default:
+      break;
+    }
+  }
+
+  void handleIO(pid_t pid, IOHandler::Kind kind, unsigned long long fd,
+                unsigned long long size) {
+    IOHandlerImpl handler{pid,
+                          kind,
+                          static_cast<int>(fd),
+                          static_cast<size_t>(size),
+                          mReturnHandlers,
+                          mProcessIds};
+    mIOHandler(handler);
+  }
+
+  void handleReturn(pid_t pid) {
+    auto it = mReturnHandlers.find(pid);
+    if (it == mReturnHandlers.end())
+      return;
+    const std::function<void(long)> handler = std::move(it->second);
+    mReturnHandlers.erase(it);
+
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, 0, &regs) == -1) {
+      if (errno == ESRCH)
+        return;
+      throw std::runtime_error(strerror(errno));
+    }
+    handler(static_cast<long>(regs.rax));
+  }
+
   int mExitCode = 0;
+  ReturnHandlers mReturnHandlers;
   NativeTracer::onFileOpenHandler mOpenFileHandler = [](std::string_view,
                                                         const OpenHandler &) {};
   NativeTracer::onStatHandler mStatHandler = [](std::string_view,
                                                 const StatHandler &) {};
-
-  std::function<void(std::stop_token)> mWorker;
-  std::jthread mThread;
+  // Empty unless I/O is profiled.
+  NativeTracer::onIOHandler mIOHandler;
+  ProcessIds mProcessIds;
+
+  // Tasks, whose initial stop has been seen. They are shared with kill(),
+  // that may be called from other threads.
+  std::mutex mMutex;
+  std::condition_variable_any mStartCondVar;
+  bool mStarted = false;
+  bool mKilled = false;
+  pid_t mPid = -1;
+  std::unordered_set<pid_t> mTasks;
+
+  TracerThread mThread;
 };
 } // namespace detail
 
@@ -365,10 +643,26 @@ void NativeTracer::onFileOpen(NativeTracer::onFileOpenHandler handler) {
 void NativeTracer::onStat(NativeTracer::onStatHandler handler) {
   mImpl->onStat(handler);
 }
+void NativeTracer::onIO(NativeTracer::onIOHandler handler) {
+  mImpl->onIO(handler);
+}
 
 void NativeTracer::start() { return mImpl->start(); }
 int NativeTracer::wait() { return mImpl->wait(); }
+bool NativeTracer::waitFor(std::chrono::milliseconds timeout) {
+  return mImpl->waitFor(timeout);
+}
 void NativeTracer::kill() { mImpl->kill(); }
 void NativeTracer::interrupt() { mImpl->interrupt(); }
 
+std::unique_ptr<Tracer> makeTracer(TracerKind kind) {
+  switch (kind) {
+  case TracerKind::Seccomp:
+    return std::make_unique<SeccompTracer>();
+  case TracerKind::Native:
+  default:
+    return std::make_unique<NativeTracer>();
+  }
+}
+
 } // namespace dpcpp_trace
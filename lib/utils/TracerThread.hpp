@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace dpcpp_trace {
+namespace detail {
+// Runs the event loop of a tracer, so that the caller can wait with a timeout
+// or stop it. Exceptions of the loop are rethrown by wait().
+class TracerThread {
+public:
+  // F is called with the stop token of the thread.
+  template <typename F> void run(F loop) {
+    mThread = std::jthread{[this, loop = std::move(loop)](
+                               std::stop_token t) mutable {
+      try {
+        loop(t);
+      } catch (...) {
+        mError = std::current_exception();
+      }
+      {
+        std::lock_guard lock{mMutex};
+        mDone = true;
+      }
+      mCondVar.notify_all();
+    }};
+  }
+
+  // Returns false if the loop is still running after timeout.
+  bool waitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock lock{mMutex};
+    return mCondVar.wait_for(lock, timeout, [this] { return mDone; });
+  }
+
+  void wait() {
+    if (mThread.joinable())
+      mThread.join();
+    if (mError)
+      std::rethrow_exception(std::exchange(mError, nullptr));
+  }
+
+  void requestStop() { mThread.request_stop(); }
+
+private:
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  bool mDone = false;
+  std::exception_ptr mError;
+  // Destroyed first, so that the loop is stopped before the state it uses.
+  std::jthread mThread;
+};
+} // namespace detail
+} // namespace dpcpp_trace
@@ -1,11 +1,51 @@
 #include "options.hpp"
 
+#include <array>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 #include <string_view>
 #include <unistd.h>
 
+static size_t parsePositive(std::string_view opt, std::string_view value) {
+  size_t result = 0;
+  try {
+    result = std::stoul(std::string{value});
+  } catch (std::exception &) {
+    result = 0;
+  }
+  if (result == 0) {
+    throw std::runtime_error(std::string(opt) +
+                             " expects a positive number, got " +
+                             std::string(value));
+  }
+  return result;
+}
+
+static int parseCompressionLevel(std::string_view value) {
+  int result = 0;
+  try {
+    result = std::stoi(std::string{value});
+  } catch (std::exception &) {
+    result = 0;
+  }
+  if (result < 1 || result > kMaxCompressionLevel) {
+    throw std::runtime_error("--level expects a number from 1 to " +
+                             std::to_string(kMaxCompressionLevel) + ", got " +
+                             std::string(value));
+  }
+  return result;
+}
+
+static dpcpp_trace::TracerKind parseTracerKind(std::string_view value) {
+  if (value == "native")
+    return dpcpp_trace::TracerKind::Native;
+  if (value == "seccomp")
+    return dpcpp_trace::TracerKind::Seccomp;
+  throw std::runtime_error("--tracer expects native or seccomp, got " +
+                           std::string(value));
+}
+
 static void parseInfoOptions(int argc, char *argv[]) {
   (void)argv;
 
@@ -37,8 +77,22 @@ void options::parseRecordOptions(int argc, char *argv[]) {
     } else if ((opt == "--skip-mem-objects" || opt == "-s") &&
                !mRecordSkipMemObjs) {
       mRecordSkipMemObjs = true;
+    } else if (opt == "--elide-info-queries" && !mRecordElideInfoQueries) {
+      mRecordElideInfoQueries = true;
+    } else if (opt == "--io-profile" && !mRecordIOProfile) {
+      mRecordIOProfile = true;
     } else if (opt == "--no-fork" && !mNoFork) {
       mNoFork = true;
+    } else if (opt == "--tracer") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--tracer requires an argument");
+      }
+      mTracer = parseTracerKind(argv[++i]);
+    } else if (opt == "--timeout") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--timeout requires an argument");
+      }
+      mTimeout = std::chrono::seconds{parsePositive(opt, argv[++i])};
     } else {
       throw std::runtime_error(std::string("unrecognized option ") +
                                std::string(argv[i]));
@@ -59,11 +113,15 @@ void options::parseRecordOptions(int argc, char *argv[]) {
   if (mOutput.empty()) {
     throw std::runtime_error("output is required");
   }
+  if (mRecordIOProfile && mTracer != dpcpp_trace::TracerKind::Native) {
+    throw std::runtime_error("--io-profile requires the native tracer");
+  }
 }
 
 void options::parseReplayOptions(int argc, char *argv[]) {
   int i = 2;
   bool hasExtraOpts = false;
+  bool hasIterations = false;
 
   while (i < argc) {
     std::string_view opt{argv[i]};
@@ -86,8 +144,40 @@ void options::parseReplayOptions(int argc, char *argv[]) {
       mOutput = argv[++i];
     } else if (opt == "--no-fork" && !mNoFork) {
       mNoFork = true;
+    } else if (opt == "--tracer") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--tracer requires an argument");
+      }
+      mTracer = parseTracerKind(argv[++i]);
+    } else if (opt == "--timeout") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--timeout requires an argument");
+      }
+      mTimeout = std::chrono::seconds{parsePositive(opt, argv[++i])};
     } else if ((opt == "--print-only" || opt == "-p") && !mPrintOnly) {
       mPrintOnly = true;
+    } else if (opt == "--tolerant" && !mReplayTolerant) {
+      mReplayTolerant = true;
+    } else if (opt == "--in-process" && !mReplayInProcess) {
+      mReplayInProcess = true;
+    } else if (opt == "--bench" && !mReplayBench) {
+      mReplayBench = true;
+    } else if (opt == "--iterations" || opt == "-n") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string(opt) + " requires an argument");
+      }
+      mReplayBenchIterations = parsePositive(opt, argv[++i]);
+      hasIterations = true;
+    } else if (opt == "--bench-output") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--bench-output requires an argument");
+      }
+      mReplayBenchOutput = argv[++i];
+    } else if (opt == "--cache-size") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--cache-size requires an argument");
+      }
+      mReplayCacheSize = parsePositive(opt, argv[++i]);
     }
 
     i++;
@@ -103,6 +193,13 @@ void options::parseReplayOptions(int argc, char *argv[]) {
     std::cerr << "input is required\n";
     std::terminate();
   }
+
+  if (mReplayBench && mPrintOnly) {
+    throw std::runtime_error("--bench can not be combined with --print-only");
+  }
+  if (!mReplayBench && (hasIterations || !mReplayBenchOutput.empty())) {
+    throw std::runtime_error("--iterations and --bench-output require --bench");
+  }
 }
 
 void options::parsePrintOptions(int argc, char *argv[]) {
@@ -157,6 +254,23 @@ void options::parsePackOptions(int argc, char *argv[]) {
         std::terminate();
       }
       mOutput = argv[++i];
+    } else if (opt == "--jobs" || opt == "-j") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string(opt) + " requires an argument");
+      }
+      mJobs = parsePositive(opt, argv[++i]);
+    } else if (opt == "--level") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--level requires an argument");
+      }
+      mCompressionLevel = parseCompressionLevel(argv[++i]);
+    } else if (opt == "--dictionary" && !mPackDictionary) {
+      mPackDictionary = true;
+    } else if (opt == "--base") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--base requires an argument");
+      }
+      mPackBase = argv[++i];
     }
 
     i++;
@@ -180,6 +294,16 @@ void options::parseUnpackOptions(int argc, char *argv[]) {
         std::terminate();
       }
       mOutput = argv[++i];
+    } else if (opt == "--only") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--only requires an argument");
+      }
+      mUnpackOnly.emplace_back(argv[++i]);
+    } else if (opt == "--jobs" || opt == "-j") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string(opt) + " requires an argument");
+      }
+      mJobs = parsePositive(opt, argv[++i]);
     }
 
     i++;
@@ -200,6 +324,8 @@ void options::parseDebugOptions(int argc, char *argv[]) {
       mInput = opt;
     } else if (opt == "--server" && !mDebugServerOnly) {
       mDebugServerOnly = true;
+    } else if (opt == "--timeout") {
+      throw std::runtime_error("--timeout is not supported by debug");
     }
 
     i++;
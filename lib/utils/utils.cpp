@@ -2,7 +2,14 @@
 #include "fork.hpp"
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
 #include <iterator>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::string which(std::string_view executable) {
   std::string_view path{getenv("PATH")};
@@ -30,3 +37,86 @@ std::string which(std::string_view executable) {
   throw std::runtime_error("Executable not found " + std::string{executable});
 }
 
+std::vector<pid_t> getProcessTree(pid_t pid) {
+  std::vector<pid_t> result{pid};
+  for (size_t i = 0; i < result.size(); i++) {
+    const std::filesystem::path tasks =
+        "/proc/" + std::to_string(result[i]) + "/task";
+    std::error_code ec;
+    for (const auto &task : std::filesystem::directory_iterator{tasks, ec}) {
+      std::ifstream is{task.path() / "children"};
+      pid_t child = 0;
+      while (is >> child)
+        result.push_back(child);
+    }
+  }
+  return result;
+}
+
+bool isPackableFile(std::string_view path) {
+  if (!path.starts_with('/'))
+    return false;
+  return !path.starts_with("/dev") && !path.starts_with("/sys") &&
+         !path.starts_with("/proc");
+}
+
+// Returns false if the kernel or file system can not copy between the files,
+// so that the caller can fall back to a regular copy.
+static bool copyFileRange(int from, int to, size_t size) {
+  while (size > 0) {
+    const ssize_t copied =
+        copy_file_range(from, nullptr, to, nullptr, size, 0);
+    if (copied < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+          errno == EOPNOTSUPP)
+        return false;
+      throw std::runtime_error(std::string("Failed to copy file: ") +
+                               std::strerror(errno));
+    }
+    // File was truncated while copying.
+    if (copied == 0)
+      break;
+    size -= copied;
+  }
+  return true;
+}
+
+void copyFile(const std::filesystem::path &from,
+              const std::filesystem::path &to) {
+  const int fromFD = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fromFD == -1)
+    throw std::runtime_error("Failed to open " + from.string());
+
+  struct stat fromStat;
+  if (fstat(fromFD, &fromStat) != 0) {
+    close(fromFD);
+    throw std::runtime_error("Failed to stat " + from.string());
+  }
+
+  const int toFD = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        fromStat.st_mode & 0777);
+  if (toFD == -1) {
+    close(fromFD);
+    throw std::runtime_error("Failed to create " + to.string());
+  }
+
+  bool copied = ioctl(toFD, FICLONE, fromFD) == 0;
+  if (!copied) {
+    try {
+      copied = copyFileRange(fromFD, toFD, fromStat.st_size);
+    } catch (...) {
+      close(fromFD);
+      close(toFD);
+      throw;
+    }
+  }
+
+  close(fromFD);
+  close(toFD);
+
+  if (!copied)
+    std::filesystem::copy_file(
+        from, to, std::filesystem::copy_options::overwrite_existing);
+}
@@ -27,6 +27,19 @@ Available commands:
       --output, -o  output directory, required.
       --skip-mem-objects, -s
                     skip record of memory objects.
+      --elide-info-queries
+                    do not record info queries, that repeat the previous
+                    answer to the same query.
+      --io-profile  record time and bytes of reads, writes and mappings of
+                    files, that the application opens; native tracer only.
+      --tracer <kind>
+                    how file accesses are intercepted, available kinds:
+                    native (ptrace), seccomp (seccomp user notifications,
+                    Linux 5.14+, replay only, record falls back to native);
+                    default: native.
+      --timeout <seconds>
+                    kill the application, if it does not exit in time, and
+                    fail.
 
 - print:
     Usage: dpcpp_trace print [OPTIONS] path/to/trace/dir
@@ -36,10 +49,12 @@ Available commands:
                    group PI call traces, available modes: none, thread;
                    default: none.
       --verbose    print as much info as possible.
-      --perf       print performance summary per group.
+      --perf       print performance summary per group and host I/O
+                   profile, if the trace was recorded with --io-profile.
 
 - replay:
     Usages: dpcpp_trace replay [OPTIONS] path/to/trace/dir
+            dpcpp_trace replay [OPTIONS] my_trace.dpcpp_trace
             dpcpp_trace replay [OPTIONS] -t /path/to/trace executable [-- args]
 
     Options:
@@ -47,6 +62,26 @@ Available commands:
                    separately.
       --print-only, -p
                    print command, that is going to be executed.
+      --tolerant   do not fail when application makes info queries, that
+                   differ from the recorded ones; skip or answer them from
+                   previously recorded values and print a summary at exit.
+      --bench      replay trace in fast mode and report PI calls/sec, time
+                   spent in the runtime per PI function and peak RSS.
+      --iterations, -n <N>
+                   number of replay iterations, requires --bench; default: 1.
+      --bench-output <file>
+                   write --bench results to a JSON file, requires --bench.
+      --cache-size <MiB>
+                   limit of files extracted on demand when replaying a packed
+                   archive; default: 1024.
+      --tracer <kind>
+                   how file accesses are intercepted, see record.
+      --timeout <seconds>
+                   kill the application, if a run does not exit in time, and
+                   fail.
+      --in-process redirect file accesses of a packed reproducer from
+                   within the application instead of tracing it; archives
+                   are extracted upfront.
 
 - pack:
     Usages:
@@ -56,6 +91,26 @@ Available commands:
     Options:
       --output, -o creates compressed trace file in addition to packing
                    reproducer; optional.
+      --jobs, -j <N>
+                   number of compression threads; default: all cores.
+      --level <N>  zstd compression level from 1 to 22; default: 3.
+      --dictionary train a zstd dictionary on small files of the trace and
+                   compress them with it.
+      --base <archive>
+                   copy files, that did not change since <archive> was
+                   packed, from it instead of compressing them again.
+
+- unpack:
+    Usages:
+      dpcpp_trace unpack my_trace.dpcpp_trace -o /path/to/trace
+      dpcpp_trace unpack my_trace.dpcpp_trace -o trace --only 'buffers/*'
+
+    Options:
+      --output, -o directory to extract trace to; must not exist.
+      --only <glob>
+                   extract only paths matching glob; may be repeated.
+      --jobs, -j <N>
+                   number of decompression threads; default: all cores.
 )___";
 
 static void printInfo() { fmt::print(infoText); }
@@ -1,36 +1,446 @@
 #include "common.hpp"
 #include "constants.hpp"
+#include "utils.hpp"
+#include "utils/Archive.hpp"
 #include "utils/Compression.hpp"
-#include "utils/MappedFile.hpp"
+#include "utils/FileAccessLog.hpp"
+#include "utils/Hash.hpp"
 #include "utils/MemoryView.hpp"
+#include "utils/MiResource.hpp"
+#include "utils/RedirectTable.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 using namespace dpcpp_trace;
 
-void pack(const options &opts) {
-  if (!std::filesystem::exists(opts.input())) {
-    std::cerr << "Path does not exist: " << opts.input() << "\n";
-    exit(EXIT_FAILURE);
+namespace {
+// Files up to this size are compressed with the trained dictionary.
+constexpr uint64_t kSmallFileSize = 128 * 1024;
+constexpr size_t kDictionarySize = 112 * 1024;
+// zstd recommends about a hundred times more samples than dictionary size.
+constexpr size_t kDictionarySamplesSize = 100 * kDictionarySize;
+
+// Part of a file, that is compressed into a single archive frame.
+struct FrameJob {
+  size_t entry;
+  uint64_t offset;
+  uint64_t size;
+  bool useDictionary;
+};
+
+struct CompressedFrame {
+  Buffer data{0};
+  Buffer compressed{0};
+  // Set if the frame could not be read or compressed, rethrown by the writer.
+  std::exception_ptr error;
+};
+
+// Compresses frames on a pool of workers, each with its own compression
+// context. Frames are handed over to the writer in the original order; workers
+// do not run further than a fixed window ahead of the writer, so that memory
+// usage does not depend on the size of the trace.
+class CompressionPipeline {
+public:
+  CompressionPipeline(const fs::path &root,
+                      const std::vector<Archive::Entry> &entries,
+                      const std::vector<FrameJob> &jobs,
+                      const Buffer &dictionary, size_t numWorkers, int level)
+      : mRoot(root), mEntries(entries), mJobs(jobs), mDictionary(dictionary),
+        mResults(jobs.size()), mWindow(numWorkers * 2) {
+    for (size_t i = 0; i < numWorkers; i++)
+      mWorkers.emplace_back([this, level] { work(level); });
   }
 
-  if (std::filesystem::exists(opts.input() / kPackedDataPath)) {
-    std::cerr << "Trace is already packed\n";
-    exit(EXIT_FAILURE);
+  ~CompressionPipeline() {
+    {
+      std::lock_guard lock{mMutex};
+      mStopped = true;
+    }
+    mCondVar.notify_all();
   }
 
-  std::filesystem::create_directory(opts.input() / kPackedDataPath);
+  // Blocks until idx-th frame is compressed. Must be called in order. Throws
+  // if the worker failed to read or compress the frame.
+  CompressedFrame take(size_t idx) {
+    std::unique_lock lock{mMutex};
+    mCondVar.wait(lock, [&] { return mResults[idx].has_value(); });
+    CompressedFrame result = std::move(*mResults[idx]);
+    mResults[idx].reset();
+    mWritten = idx + 1;
+    lock.unlock();
+    mCondVar.notify_all();
+    if (result.error)
+      std::rethrow_exception(result.error);
+    return result;
+  }
+
+private:
+  void work(int level) {
+    Compression comp{level};
+    Compression dictComp{level};
+    dictComp.setDictionary(MemoryView{mDictionary.data(), mDictionary.size()});
+    // Frames are released by the writer once they are written out, their
+    // memory is reused for the following reads.
+    BufferPool pool{detail::getMiResource()};
+
+    while (true) {
+      size_t idx;
+      {
+        std::unique_lock lock{mMutex};
+        mCondVar.wait(lock, [&] {
+          return mStopped || mNext >= mJobs.size() ||
+                 mNext < mWritten + mWindow;
+        });
+        if (mStopped || mNext >= mJobs.size())
+          return;
+        idx = mNext++;
+      }
+
+      CompressedFrame result;
+      try {
+        const FrameJob &job = mJobs[idx];
+        const fs::path path = mRoot / mEntries[job.entry].path;
+        std::ifstream is{path, std::ios::binary};
+        if (!is)
+          throw std::runtime_error("Failed to open " + path.string());
+        is.seekg(job.offset);
+
+        result.data = pool.acquire(job.size);
+        is.read(result.data.as<char>(), job.size);
+        if (static_cast<uint64_t>(is.gcount()) != job.size)
+          throw std::runtime_error("Failed to read " + path.string() +
+                                   ", file changed while packing");
+        result.compressed =
+            (job.useDictionary ? dictComp : comp)
+                .compress(MemoryView{result.data.data(), result.data.size()});
+      } catch (...) {
+        result.error = std::current_exception();
+      }
+
+      {
+        std::lock_guard lock{mMutex};
+        mResults[idx] = std::move(result);
+      }
+      mCondVar.notify_all();
+    }
+  }
+
+  const fs::path &mRoot;
+  const std::vector<Archive::Entry> &mEntries;
+  const std::vector<FrameJob> &mJobs;
+  const Buffer &mDictionary;
+  std::vector<std::optional<CompressedFrame>> mResults;
+  const size_t mWindow;
+  size_t mNext = 0;
+  size_t mWritten = 0;
+  bool mStopped = false;
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  std::vector<std::jthread> mWorkers;
+};
+
+constexpr size_t kChunkSize = 1024 * 1024;
+
+uint64_t hashFile(const fs::path &path) {
+  std::ifstream is{path, std::ios::binary};
+  std::vector<char> chunk(kChunkSize);
+  XXHash64 hash;
+  while (is.read(chunk.data(), chunk.size()) || is.gcount() > 0)
+    hash.update(chunk.data(), is.gcount());
+  return hash.digest();
+}
+
+// Stores every unique dependency in pack/ once. Files are the same if they
+// are the same inode (hard links, symlinks, paths opened many times) or have
+// the same contents (e.g. copies of a library in different directories).
+class PackedFileStore {
+public:
+  explicit PackedFileStore(fs::path dir) : mDir(std::move(dir)) {}
+
+  // Returns name of the packed copy of path, which is name if the file has
+  // not been stored before.
+  std::string add(const fs::path &path, const std::string &name) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+      throw std::runtime_error("Failed to stat " + path.string());
+    return add(path, name, std::make_pair(st.st_dev, st.st_ino));
+  }
+
+  // Same, but the inode is known from record.
+  std::string add(const fs::path &path, const std::string &name,
+                  std::pair<dev_t, ino_t> inode) {
+    if (auto it = mByInode.find(inode); it != mByInode.end())
+      return it->second;
+
+    const uint64_t hash = hashFile(path);
+    auto [begin, end] = mByHash.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      if (sameContents(path, mDir / it->second)) {
+        mByInode.emplace(inode, it->second);
+        return it->second;
+      }
+    }
+
+    copyFile(path, mDir / name);
+    mByInode.emplace(inode, name);
+    mByHash.emplace(hash, name);
+    return name;
+  }
+
+private:
+  static bool sameContents(const fs::path &a, const fs::path &b) {
+    if (fs::file_size(a) != fs::file_size(b))
+      return false;
+
+    std::ifstream isA{a, std::ios::binary};
+    std::ifstream isB{b, std::ios::binary};
+    std::vector<char> chunkA(kChunkSize);
+    std::vector<char> chunkB(kChunkSize);
+    while (isA.read(chunkA.data(), kChunkSize) || isA.gcount() > 0) {
+      isB.read(chunkB.data(), kChunkSize);
+      if (isA.gcount() != isB.gcount() ||
+          !std::equal(chunkA.begin(), chunkA.begin() + isA.gcount(),
+                      chunkB.begin()))
+        return false;
+    }
+    return true;
+  }
+
+  fs::path mDir;
+  std::map<std::pair<dev_t, ino_t>, std::string> mByInode;
+  std::unordered_multimap<uint64_t, std::string> mByHash;
+};
+} // namespace
+
+static int64_t getModificationTime(const fs::path &path) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             fs::last_write_time(path).time_since_epoch())
+      .count();
+}
+
+static Buffer readFile(const fs::path &path, uint64_t size) {
+  Buffer buf = Buffer::uninitialized(size);
+  std::ifstream is{path, std::ios::binary};
+  is.read(buf.as<char>(), size);
+  buf.resizeUninitialized(is.gcount());
+  return buf;
+}
+
+// Trains a dictionary on small files. Traces have many of them (per-thread
+// traces, buffer descriptors, configs), and they are similar to each other.
+static Buffer trainDictionary(const fs::path &root,
+                              const std::vector<Archive::Entry> &entries) {
+  std::vector<Buffer> samples;
+  size_t samplesSize = 0;
+  for (const auto &entry : entries) {
+    if (entry.isDirectory || entry.size == 0 || entry.size > kSmallFileSize)
+      continue;
+    if (samplesSize + entry.size > kDictionarySamplesSize)
+      break;
+    samples.push_back(readFile(root / entry.path, entry.size));
+    samplesSize += samples.back().size();
+  }
+
+  Buffer dict = Compression::trainDictionary(samples, kDictionarySize);
+  if (dict.size() == 0)
+    std::clog << "Not enough small files to train a dictionary\n";
+  return dict;
+}
+
+// Finds files, that did not change since the base archive was packed. Files
+// with the same path, size and modification time are assumed unchanged, other
+// ones are looked up by contents hash, which is much cheaper than compression.
+static std::vector<const Archive::Entry *>
+findReusableEntries(const Archive &base, const fs::path &root,
+                    const std::vector<Archive::Entry> &entries) {
+  std::unordered_multimap<uint64_t, const Archive::Entry *> byHash;
+  for (const auto &baseEntry : base.entries()) {
+    if (!baseEntry.isDirectory)
+      byHash.emplace(baseEntry.hash, &baseEntry);
+  }
+
+  std::vector<const Archive::Entry *> reused(entries.size(), nullptr);
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto &entry = entries[i];
+    if (entry.isDirectory)
+      continue;
+
+    const Archive::Entry *cand = base.find(entry.path);
+    if (cand && !cand->isDirectory && cand->size == entry.size &&
+        cand->mtime == entry.mtime) {
+      reused[i] = cand;
+      continue;
+    }
+
+    auto [begin, end] = byHash.equal_range(hashFile(root / entry.path));
+    for (auto it = begin; it != end; ++it) {
+      if (it->second->size == entry.size) {
+        reused[i] = it->second;
+        break;
+      }
+    }
+  }
+
+  return reused;
+}
 
-  std::ifstream recordFilesConfig{opts.input() / kFilesConfigName};
-  json recordFiles;
-  recordFilesConfig >> recordFiles;
+static void writeArchive(const options &opts) {
+  const fs::path root = opts.input();
+
+  std::vector<Archive::Entry> entries;
+  for (auto &p : fs::recursive_directory_iterator(root)) {
+    if (!fs::is_directory(p) && !fs::is_regular_file(p))
+      continue;
+
+    Archive::Entry entry;
+    entry.path = fs::relative(p, root).string();
+    entry.isDirectory = fs::is_directory(p);
+    if (!entry.isDirectory) {
+      entry.mtime = getModificationTime(p);
+      // Used as a size hint until the file is actually read.
+      entry.size = fs::file_size(p);
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  std::unique_ptr<Archive> base;
+  std::vector<const Archive::Entry *> reused(entries.size(), nullptr);
+  if (!opts.pack_base().empty()) {
+    if (fs::exists(opts.output()) &&
+        fs::equivalent(opts.output(), opts.pack_base()))
+      throw std::runtime_error("--base must differ from --output");
+
+    base = std::make_unique<Archive>(opts.pack_base());
+    if (base->version() == 0) {
+      std::clog << "Frames of v0 archives can not be reused, packing all "
+                   "files\n";
+      base.reset();
+    } else {
+      reused = findReusableEntries(*base, root, entries);
+    }
+  }
+
+  // Reused frames may depend on the dictionary of the base archive.
+  Buffer dictionary{0};
+  if (base) {
+    dictionary.resize(base->dictionary().size());
+    std::copy(base->dictionary().begin(), base->dictionary().end(),
+              dictionary.data());
+  } else if (opts.pack_dictionary()) {
+    dictionary = trainDictionary(root, entries);
+  }
+
+  std::vector<FrameJob> jobs;
+  size_t numReused = 0;
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto &entry = entries[i];
+    if (entry.isDirectory)
+      continue;
+    if (reused[i]) {
+      numReused++;
+      continue;
+    }
+
+    const bool useDictionary =
+        dictionary.size() > 0 && entry.size <= kSmallFileSize;
+    for (uint64_t offset = 0; offset < entry.size; offset += kArchiveFrameSize)
+      jobs.push_back(FrameJob{
+          i, offset, std::min(kArchiveFrameSize, entry.size - offset),
+          useDictionary});
+    entry.size = 0;
+  }
+
+  size_t numWorkers = opts.jobs();
+  if (numWorkers == 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+  std::ofstream os{opts.output(), std::ios::binary};
+  Archive::writeHeader(os, dictionary);
+
+  // Frames of unchanged files are copied as is.
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!reused[i])
+      continue;
+
+    entries[i].size = reused[i]->size;
+    entries[i].hash = reused[i]->hash;
+    for (const auto &frame : reused[i]->frames) {
+      entries[i].frames.push_back(
+          Archive::Frame{static_cast<uint64_t>(os.tellp()), frame.size});
+      const auto data = base->frameData(frame);
+      os.write(reinterpret_cast<const char *>(data.data()), frame.size);
+    }
+  }
+
+  {
+    CompressionPipeline pipeline{root,
+                                 entries,
+                                 jobs,
+                                 dictionary,
+                                 numWorkers,
+                                 opts.compression_level()};
+
+    // Hash of the file, that is currently written.
+    std::optional<XXHash64> hash;
+    for (size_t i = 0; i < jobs.size(); i++) {
+      Archive::Entry &entry = entries[jobs[i].entry];
+      if (!hash)
+        hash.emplace();
+
+      const CompressedFrame frame = pipeline.take(i);
+      hash->update(frame.data.data(), frame.data.size());
+      entry.size += frame.data.size();
+      entry.frames.push_back(
+          Archive::Frame{static_cast<uint64_t>(os.tellp()),
+                         frame.compressed.size()});
+      os.write(frame.compressed.as<char>(), frame.compressed.size());
+
+      if (i + 1 == jobs.size() || jobs[i + 1].entry != jobs[i].entry) {
+        entry.hash = hash->digest();
+        hash.reset();
+      }
+    }
+  }
+
+  // Empty files have no frames.
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!entries[i].isDirectory && !reused[i] && entries[i].frames.empty())
+      entries[i].hash = xxh64(std::string_view{});
+  }
+
+  Archive::writeDirectory(os, entries);
+  os.close();
+
+  if (base) {
+    std::clog << "Reused " << numReused << " unchanged files from "
+              << opts.pack_base().string() << "\n";
+  }
+}
+
+static void packDependencies(const options &opts) {
+  std::filesystem::create_directory(opts.input() / kPackedDataPath);
 
   json replayMap;
 
@@ -39,80 +449,87 @@ void pack(const options &opts) {
   replayConfigIn >> replayConfig;
   replayConfigIn.close();
 
+  PackedFileStore store{opts.input() / kPackedDataPath};
+
   std::filesystem::path executable{
       replayConfig[kReplayExecutable].get<std::string>()};
-  std::filesystem::copy_file(executable, opts.input() / kPackedDataPath / "0");
+  store.add(executable, "0");
 
   replayMap[executable.string()] = "0";
 
-  size_t counter = 1;
+  // Replay looks up every opened path, so the map is also stored as a hash
+  // table, that is used in place.
+  RedirectTableBuilder redirectTable;
+  const std::filesystem::path packedDataPath{kPackedDataPath};
+  redirectTable.add(executable.string(), (packedDataPath / "0").string());
 
-  for (auto &element : recordFiles) {
-    std::string candString = element.get<std::string>();
-    if (candString.starts_with("/dev"))
-      continue;
-    if (candString.starts_with("/sys"))
-      continue;
-    if (candString.starts_with("/proc"))
-      continue;
+  size_t counter = 1;
 
+  const auto addFile = [&](const std::string &candString, const auto &add) {
     std::filesystem::path candPath{candString};
-    if (!std::filesystem::is_regular_file(candPath))
-      continue;
+    const std::string newFileName =
+        std::to_string(counter) + "_" + candPath.stem().string();
 
-    std::string newFileName =
-        std::to_string(counter++) + "_" + candPath.stem().string();
+    const std::string packedName = add(candPath, newFileName);
+    if (packedName == newFileName)
+      counter++;
+    replayMap[candString] = packedName;
+    redirectTable.add(candString, (packedDataPath / packedName).string());
+  };
 
-    std::filesystem::copy_file(candPath,
-                               opts.input() / kPackedDataPath / newFileName);
-    replayMap[candString] = newFileName;
+  if (std::filesystem::exists(opts.input() / kFileAccessLogName)) {
+    // Results of opens and file metadata are known from record.
+    for (const FileAccess &access :
+         FileAccessLog::read(opts.input() / kFileAccessLogName)) {
+      if (!access.opened || !access.regular || !isPackableFile(access.path))
+        continue;
+      addFile(access.path, [&](const fs::path &path, const std::string &name) {
+        return store.add(path, name,
+                         std::make_pair(static_cast<dev_t>(access.device),
+                                        static_cast<ino_t>(access.inode)));
+      });
+    }
+  } else {
+    std::ifstream recordFilesConfig{opts.input() / kFilesConfigName};
+    json recordFiles;
+    recordFilesConfig >> recordFiles;
+
+    for (auto &element : recordFiles) {
+      std::string candString = element.get<std::string>();
+      if (!isPackableFile(candString) ||
+          !std::filesystem::is_regular_file(candString))
+        continue;
+      addFile(candString, [&](const fs::path &path, const std::string &name) {
+        return store.add(path, name);
+      });
+    }
   }
 
   std::ofstream replayFilesMapConfig{opts.input() / kReplayFileMapConfigName};
   replayFilesMapConfig << replayMap.dump(2);
   replayFilesMapConfig.close();
+  redirectTable.write(opts.input() / kRedirectTableName);
 
   replayConfig[kRecordMode] = kRecordModeFull;
 
   std::ofstream replayConfigOut{opts.input() / kReplayConfigName};
   replayConfigOut << replayConfig.dump(4);
   replayConfigOut.close();
+}
+
+void pack(const options &opts) {
+  if (!std::filesystem::exists(opts.input())) {
+    std::cerr << "Path does not exist: " << opts.input() << "\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (std::filesystem::exists(opts.input() / kPackedDataPath)) {
+    std::clog << "Trace is already packed, reusing packed files\n";
+  } else {
+    packDependencies(opts);
+  }
 
   if (!opts.output().empty()) {
-    std::ofstream os{opts.output(), std::ios::binary};
-    char version = 0;
-    os.write(&version, sizeof(char));
-
-    Compression comp;
-
-    for (auto &p : fs::recursive_directory_iterator(opts.input())) {
-      auto rel = fs::relative(p, opts.input());
-      std::string pathStr = rel.string();
-      if (fs::is_directory(p)) {
-        char kind = 0;
-        os.write(&kind, sizeof(char));
-        uint64_t size = pathStr.size();
-        os.write(reinterpret_cast<char *>(&size), sizeof(size));
-        os.write(pathStr.data(), pathStr.size());
-      } else if (fs::is_regular_file(p)) {
-        char kind = 1;
-        os.write(&kind, sizeof(char));
-        uint64_t size = pathStr.size();
-        os.write(reinterpret_cast<char *>(&size), sizeof(size));
-        os.write(pathStr.data(), pathStr.size());
-
-        MappedFile mapping{p};
-        const auto compBuf = comp.compress(mapping);
-        uint64_t length = compBuf.size();
-        os.write(reinterpret_cast<char *>(&length), sizeof(uint64_t));
-        os.write(compBuf.as<char>(), compBuf.size());
-        if (pathStr == "replay_config.json") {
-          std::cout << "Packed size " << compBuf.size();
-          auto dec =
-              comp.uncompress(MemoryView{compBuf.data(), compBuf.size()});
-        }
-      }
-    }
-    os.close();
+    writeArchive(opts);
   }
 }
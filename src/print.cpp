@@ -7,13 +7,16 @@
 #include "pi_arguments_handler.hpp"
 #include <CL/sycl/detail/pi.h>
 #include <fmt/core.h>
+#include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -31,6 +34,8 @@ struct PerformanceSummary {
   size_t totalDuration;
 };
 
+using json = nlohmann::json;
+
 using RecordT = std::pair<std::string, dpcpp_trace::APICall>;
 
 static std::string getAPIName(uint32_t id) {
@@ -103,6 +108,74 @@ printPerformanceSummary(std::map<uint32_t, PerformanceSummary> &perfMap) {
   }
 }
 
+// Process and thread ids, that threads had at record time, by thread name.
+static std::map<std::string, std::string>
+readThreadTable(const std::filesystem::path &traceDir) {
+  std::map<std::string, std::string> table;
+  std::ifstream is{traceDir / kThreadTableName};
+  std::string name, pid, tid;
+  while (is >> name >> pid >> tid)
+    table[name] = fmt::format("process {}, thread {}", pid, tid);
+  return table;
+}
+
+// Host I/O of the application, that record saved with --io-profile. Access
+// times are relative to the start of PI call times, so that they can be
+// compared with the trace, and are negative for I/O before the first PI call.
+// Applications, that made no PI calls, are shown relative to their first I/O.
+static void printIOProfile(const std::filesystem::path &traceDir) {
+  const std::filesystem::path profilePath = traceDir / kIOProfileName;
+  if (!std::filesystem::exists(profilePath))
+    return;
+
+  std::ifstream profileFile{profilePath};
+  const json profile = json::parse(profileFile);
+
+  int64_t startNs = std::numeric_limits<int64_t>::max();
+  if (!(std::ifstream{traceDir / kRecordStartTimeName} >> startNs)) {
+    for (const auto &entry : profile)
+      startNs = std::min(startNs, entry["firstAccessNs"].get<int64_t>());
+  }
+
+  struct FileSummary {
+    std::string path;
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    uint64_t timeNs = 0;
+    int64_t firstAccessNs = 0;
+    int64_t lastAccessNs = 0;
+  };
+  std::vector<FileSummary> summaries;
+  for (const auto &entry : profile) {
+    FileSummary &summary = summaries.emplace_back();
+    summary.path = entry["path"].get<std::string>();
+    for (const char *kind : {"read", "write", "mmap"}) {
+      summary.calls += entry[kind]["calls"].get<uint64_t>();
+      summary.bytes += entry[kind]["bytes"].get<uint64_t>();
+      summary.timeNs += entry[kind]["timeNs"].get<uint64_t>();
+    }
+    summary.firstAccessNs = entry["firstAccessNs"].get<int64_t>() - startNs;
+    summary.lastAccessNs = entry["lastAccessNs"].get<int64_t>() - startNs;
+  }
+  std::sort(summaries.begin(), summaries.end(),
+            [](const FileSummary &a, const FileSummary &b) {
+              return a.timeNs > b.timeNs;
+            });
+
+  constexpr size_t kMaxPathSize = 45;
+  fmt::print("Host I/O summary:\n");
+  fmt::print("{:>45} | {:^15} | {:^15} | {:^15} | {:^15} | {:^15} |\n", " ",
+             "Calls", "Bytes", "Time", "First access", "Last access");
+  for (const FileSummary &summary : summaries) {
+    std::string path = summary.path;
+    if (path.size() > kMaxPathSize)
+      path = "..." + path.substr(path.size() - kMaxPathSize + 3);
+    fmt::print("{:>45} | {:15} | {:15} | {:13}us | {:13}us | {:13}us |\n", path,
+               summary.calls, summary.bytes, summary.timeNs / 1000,
+               summary.firstAccessNs / 1000, summary.lastAccessNs / 1000);
+  }
+}
+
 void printImageDesc(std::filesystem::path path) {
   std::ifstream is{path, std::ios::binary};
   uint64_t size;
@@ -205,6 +278,8 @@ void printTrace(const options &opts) {
   };
 
   if (opts.print_group() == options::print_group_by::thread) {
+    const std::map<std::string, std::string> threads =
+        readThreadTable(opts.input());
     std::string lastThread = "";
     for (auto &r : records) {
       if (lastThread != r.first) {
@@ -212,7 +287,10 @@ void printTrace(const options &opts) {
           std::cout << "~END THREAD : " << lastThread << "\n\n";
         }
         lastThread = r.first;
-        std::cout << "~START THREAD : " << lastThread << "\n\n";
+        std::cout << "~START THREAD : " << lastThread;
+        if (auto it = threads.find(lastThread); it != threads.end())
+          std::cout << " (" << it->second << ")";
+        std::cout << "\n\n";
       }
       printRecord(r, opts.verbose());
       collectPerf(r);
@@ -236,4 +314,7 @@ void printTrace(const options &opts) {
       printPerformanceSummary(perfMap);
     }
   }
+
+  if (opts.performance_summary())
+    printIOProfile(opts.input());
 }
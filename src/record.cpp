@@ -1,9 +1,12 @@
 #include "common.hpp"
 #include "constants.hpp"
 #include "fork.hpp"
+#include "utils/FileAccessLog.hpp"
 #include "utils/Tracer.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <dlfcn.h>
 #include <exception>
@@ -11,10 +14,17 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <utility>
 
 using json = nlohmann::json;
 
@@ -28,6 +38,53 @@ static bool canLoadLibrary(std::string_view libName) {
   return res;
 }
 
+// Host I/O of a file, times are steady clock nanoseconds.
+struct IOStats {
+  uint64_t calls = 0;
+  uint64_t bytes = 0;
+  uint64_t timeNs = 0;
+};
+
+struct FileIOProfile {
+  IOStats read;
+  IOStats write;
+  IOStats mmap;
+  int64_t firstAccessNs = std::numeric_limits<int64_t>::max();
+  int64_t lastAccessNs = 0;
+};
+
+static int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static json toJson(const IOStats &stats) {
+  json res;
+  res["calls"] = stats.calls;
+  res["bytes"] = stats.bytes;
+  res["timeNs"] = stats.timeNs;
+  return res;
+}
+
+static void
+writeIOProfile(const std::filesystem::path &file,
+               const std::unordered_map<std::string, FileIOProfile> &profile) {
+  json files = json::array();
+  for (const auto &[path, fileProfile] : profile) {
+    json entry;
+    entry["path"] = path;
+    entry["read"] = toJson(fileProfile.read);
+    entry["write"] = toJson(fileProfile.write);
+    entry["mmap"] = toJson(fileProfile.mmap);
+    entry["firstAccessNs"] = fileProfile.firstAccessNs;
+    entry["lastAccessNs"] = fileProfile.lastAccessNs;
+    files.push_back(std::move(entry));
+  }
+  std::ofstream os{file};
+  os << files.dump(4);
+}
+
 void record(const options &opts) {
   if (std::filesystem::exists(opts.output())) {
     if (opts.record_override_trace()) {
@@ -75,6 +132,7 @@ void record(const options &opts) {
       replayConfig[kRecordMode] = kRecordModeTraceOnly;
     else
       replayConfig[kRecordMode] = kRecordModeDefault;
+    replayConfig[kRecordElideInfoQueries] = opts.record_elide_info_queries();
 
     replayConfig[kReplayCommand] = opts.input().string();
     replayConfig[kReplayExecutable] = executable;
@@ -118,24 +176,155 @@ void record(const options &opts) {
     env.push_back(skipVal);
   }
 
-  dpcpp_trace::NativeTracer tracer;
+  std::string elideVal = kElideInfoQueriesEnvVar;
+  elideVal += "=1";
+  if (opts.record_elide_info_queries()) {
+    env.push_back(elideVal);
+  }
+
+  // Results of opens are needed to pack files, and the seccomp tracer does not
+  // report them for calls, that the tracee makes itself.
+  if (opts.tracer() != dpcpp_trace::TracerKind::Native)
+    std::clog << "WARNING: record does not support --tracer seccomp, using "
+                 "native tracer\n";
+  std::unique_ptr<dpcpp_trace::Tracer> tracer =
+      dpcpp_trace::makeTracer(dpcpp_trace::TracerKind::Native);
 
-  json files;
+  dpcpp_trace::FileAccessLog files;
+  // Files of descriptors, that are open in processes of the application, and
+  // their I/O.
+  std::map<std::pair<int, int>, std::string> openFiles;
+  std::unordered_map<std::string, FileIOProfile> ioProfile;
+  std::mutex filesMutex;
+  const bool profileIO = opts.record_io_profile();
 
-  tracer.onFileOpen(
-      [&files](std::string_view fileName, const dpcpp_trace::OpenHandler &h) {
-        std::string fn{fileName};
-        files.push_back(fn);
+  tracer->onFileOpen([&, profileIO](std::string_view fileName,
+                                    const dpcpp_trace::OpenHandler &h) {
+    bool needsMetadata = false;
+    {
+      std::lock_guard lock{filesMutex};
+      dpcpp_trace::FileAccess &entry = files[fileName];
+      entry.flags |= h.flags();
+      // Results are needed only once per path, unless its descriptors are
+      // profiled. Relative paths may resolve to packable files.
+      needsMetadata = !entry.opened && (isPackableFile(fileName) ||
+                                        !fileName.starts_with('/'));
+    }
+    if (!needsMetadata && !profileIO)
+      return;
+
+    h.onReturn([&, profileIO, needsMetadata, pid = h.pid(), flags = h.flags(),
+                path = std::string{fileName}](long res) {
+      if (res < 0)
+        return;
+
+      // The path may be relative to the working directory of the tracee or a
+      // directory descriptor, so the file is looked up by its new descriptor.
+      // Another thread may have closed it already, then a later open of the
+      // same path retries.
+      const std::filesystem::path fdPath = std::filesystem::path{"/proc"} /
+                                           std::to_string(pid) / "fd" /
+                                           std::to_string(res);
+      std::error_code ec;
+      std::string resolved;
+      struct stat st;
+      bool hasStat = false;
+      if (needsMetadata) {
+        resolved = std::filesystem::read_symlink(fdPath, ec).string();
+        hasStat = !ec && stat(fdPath.c_str(), &st) == 0;
+      }
+
+      std::lock_guard lock{filesMutex};
+      if (profileIO)
+        openFiles[{pid, static_cast<int>(res)}] = path;
+      if (!hasStat)
+        return;
+
+      files[path].opened = true;
+      // Absolute paths are kept, so that symbolic links to libraries are packed
+      // under the names, that the application opens.
+      const std::string &key = path.starts_with('/') ? path : resolved;
+      if (!isPackableFile(key))
+        return;
+      dpcpp_trace::FileAccess &entry = files[key];
+      entry.flags |= flags;
+      entry.opened = true;
+      entry.regular = S_ISREG(st.st_mode);
+      entry.device = st.st_dev;
+      entry.inode = st.st_ino;
+      entry.size = st.st_size;
+      entry.modificationTimeNs =
+          int64_t{st.st_mtim.tv_sec} * 1'000'000'000 + st.st_mtim.tv_nsec;
+    });
+  });
+
+  // Calls are timed from the stop at their entry to the stop at their exit,
+  // which includes the tracer's own overhead.
+  if (profileIO) {
+    tracer->onIO([&](const dpcpp_trace::IOHandler &h) {
+      using Kind = dpcpp_trace::IOHandler::Kind;
+      const std::pair<int, int> key{h.pid(), h.fd()};
+
+      std::string path;
+      {
+        std::lock_guard lock{filesMutex};
+        auto it = openFiles.find(key);
+        if (it == openFiles.end())
+          return;
+        if (h.kind() == Kind::Close) {
+          openFiles.erase(it);
+          return;
+        }
+        path = it->second;
+      }
+
+      h.onReturn([&, path = std::move(path), kind = h.kind(), size = h.size(),
+                  start = nowNs()](long res) {
+        const int64_t end = nowNs();
+        if (res < 0)
+          return;
+
+        std::lock_guard lock{filesMutex};
+        FileIOProfile &profile = ioProfile[path];
+        IOStats &stats = kind == Kind::Read    ? profile.read
+                         : kind == Kind::Write ? profile.write
+                                               : profile.mmap;
+        stats.calls++;
+        stats.bytes += kind == Kind::MMap ? size : static_cast<size_t>(res);
+        stats.timeNs += end - start;
+        profile.firstAccessNs = std::min(profile.firstAccessNs, start);
+        profile.lastAccessNs = std::max(profile.lastAccessNs, end);
       });
+    });
+  }
+
+  tracer->launch(executable, execArgs, env);
+  tracer->start();
+  // Files, that were opened before the timeout, are still saved.
+  const bool timedOut =
+      opts.timeout().count() != 0 && !tracer->waitFor(opts.timeout());
+  if (timedOut)
+    tracer->kill();
+  int code = tracer->wait();
 
-  tracer.launch(executable, execArgs, env);
-  tracer.start();
-  int code = tracer.wait();
+  files.write(opts.output() / kFileAccessLogName);
 
+  // Unique paths, that the application tried to open, for users and older
+  // versions of pack.
+  json fileNames = json::array();
+  for (const auto &entry : files.entries())
+    fileNames.push_back(entry.path);
   std::ofstream filesOut{opts.output() / kFilesConfigName};
-  filesOut << files.dump(4);
+  filesOut << fileNames.dump(4);
   filesOut.close();
 
+  if (profileIO)
+    writeIOProfile(opts.output() / kIOProfileName, ioProfile);
+
+  if (timedOut)
+    throw std::runtime_error("Child application did not exit in " +
+                             std::to_string(opts.timeout().count()) +
+                             " seconds");
   if (code != 0)
     throw std::runtime_error("Child application exited with code " +
                              std::to_string(code));
@@ -2,19 +2,32 @@
 #include "constants.hpp"
 #include "fork.hpp"
 #include "utils.hpp"
+#include "utils/Archive.hpp"
+#include "utils/ArchiveCache.hpp"
+#include "utils/MappedFile.hpp"
+#include "utils/RedirectTable.hpp"
 #include "utils/Tracer.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
 #include <fmt/core.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <poll.h>
 #include <ranges>
 #include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -22,13 +35,232 @@
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
+struct BenchSummary {
+  size_t calls = 0;
+  uint64_t runtimeNs = 0;
+  uint64_t pluginNs = 0;
+};
+
+static void collectBenchStats(const fs::path &benchDir,
+                              std::map<std::string, BenchSummary> &stats) {
+  for (auto &de : fs::directory_iterator(benchDir)) {
+    if (de.path().extension().string() != kReplayBenchExt)
+      continue;
+
+    std::ifstream is{de.path()};
+    std::string name;
+    BenchSummary entry;
+    while (is >> name >> entry.calls >> entry.runtimeNs >> entry.pluginNs) {
+      auto &summary = stats[name];
+      summary.calls += entry.calls;
+      summary.runtimeNs += entry.runtimeNs;
+      summary.pluginNs += entry.pluginNs;
+    }
+    is.close();
+    fs::remove(de.path());
+  }
+}
+
+static void runBench(const options &opts, const fs::path &tracePath,
+                     const fs::path &benchDir,
+                     const std::function<int()> &runOnce) {
+  using namespace std::chrono;
+
+  std::map<std::string, BenchSummary> stats;
+  std::vector<double> wallTimes;
+  size_t totalCalls = 0;
+
+  for (size_t i = 0; i < opts.replay_bench_iterations(); i++) {
+    const auto start = steady_clock::now();
+    int code = runOnce();
+    const auto end = steady_clock::now();
+
+    if (code != 0)
+      throw std::runtime_error(fmt::format(
+          "Replay iteration {} exited with code {}", i, code));
+
+    wallTimes.push_back(duration<double>(end - start).count());
+    collectBenchStats(benchDir, stats);
+  }
+
+  fs::remove_all(benchDir);
+
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+
+  json result;
+  result["trace"] = tracePath.string();
+  result["iterations"] = opts.replay_bench_iterations();
+  result["wallTimeSec"] = wallTimes;
+
+  double totalWallTime = 0;
+  for (double t : wallTimes)
+    totalWallTime += t;
+
+  json functions = json::object();
+  uint64_t totalRuntimeNs = 0;
+  for (auto &[name, summary] : stats) {
+    totalCalls += summary.calls;
+    totalRuntimeNs += summary.runtimeNs;
+    functions[name] = {
+        {"calls", summary.calls},
+        {"runtimeNs", summary.runtimeNs},
+        {"pluginNs", summary.pluginNs},
+        {"avgRuntimeNs", summary.runtimeNs / summary.calls},
+    };
+  }
+
+  result["piCalls"] = totalCalls;
+  result["piCallsPerSec"] =
+      totalWallTime > 0 ? static_cast<double>(totalCalls) / totalWallTime : 0;
+  result["runtimeNs"] = totalRuntimeNs;
+  result["maxRssKb"] = usage.ru_maxrss;
+  result["functions"] = functions;
+
+  fmt::print("Replayed {} PI calls in {} iterations: {:.0f} calls/sec, max "
+             "RSS {} KB\n",
+             totalCalls, wallTimes.size(),
+             result["piCallsPerSec"].get<double>(), usage.ru_maxrss);
+  fmt::print("{:>35} | {:^15} | {:^15} | {:^15} |\n", " ", "Calls",
+             "Runtime time", "Avg runtime");
+  for (auto &[name, summary] : stats) {
+    fmt::print("{:>35} | {:15} | {:13}us | {:13}ns |\n", name, summary.calls,
+               summary.runtimeNs / 1000, summary.runtimeNs / summary.calls);
+  }
+
+  if (!opts.replay_bench_output().empty()) {
+    std::ofstream os{opts.replay_bench_output()};
+    os << result.dump(4);
+    os.close();
+  }
+}
+
+// Top-level files of the trace are always needed, other ones are extracted,
+// when the application opens them.
+static void extractTraceFiles(const dpcpp_trace::Archive &archive,
+                              dpcpp_trace::ArchiveCache &cache) {
+  for (const auto &entry : archive.entries()) {
+    if (!entry.isDirectory && entry.path.find('/') == std::string::npos)
+      cache.extract(entry.path, /*pinned*/ true);
+  }
+}
+
+// Traces packed by older versions only have the JSON file map.
+static void writeRedirectTable(const fs::path &tracePath) {
+  json replayFileMap;
+  std::ifstream fileMap{tracePath / kReplayFileMapConfigName};
+  fileMap >> replayFileMap;
+  fileMap.close();
+
+  dpcpp_trace::RedirectTableBuilder builder;
+  for (const auto &el : replayFileMap.items()) {
+    const fs::path packed =
+        fs::path{kPackedDataPath} / el.value().get<std::string>();
+    builder.add(el.key(), packed.string());
+  }
+  builder.write(tracePath / kRedirectTableName);
+}
+
+// The dynamic loader resolves dependencies of the executable before
+// libsystem_redirect is loaded, and dlopen is not interposed, so packed
+// libraries are linked into a directory, that is searched first.
+static void linkRedirectLibraries(const fs::path &tracePath,
+                                  const dpcpp_trace::redirect_table::View &t) {
+  const fs::path libsPath = tracePath / kRedirectLibsPath;
+  fs::remove_all(libsPath);
+  fs::create_directories(libsPath);
+
+  const fs::path absTracePath = fs::absolute(tracePath);
+  t.forEachLibrary([&](std::string_view name, const char *replacement) {
+    std::error_code ec;
+    fs::create_symlink(absTracePath / replacement, libsPath / name, ec);
+  });
+}
+
+static std::runtime_error timeoutError(std::chrono::seconds timeout) {
+  return std::runtime_error("Application did not exit in " +
+                            std::to_string(timeout.count()) + " seconds");
+}
+
+// Packed reproducers, that redirect files in-process, run without a tracer.
+static int runUntraced(const std::string &executable,
+                       std::span<std::string> args,
+                       std::span<std::string> env,
+                       std::chrono::seconds timeout) {
+  const auto toCString = [](const std::string &str) { return str.c_str(); };
+
+  std::vector<const char *> cArgs;
+  std::transform(args.begin(), args.end(), std::back_inserter(cArgs),
+                 toCString);
+  cArgs.push_back(nullptr);
+
+  std::vector<const char *> cEnv;
+  std::transform(env.begin(), env.end(), std::back_inserter(cEnv), toCString);
+  cEnv.push_back(nullptr);
+
+  const pid_t child = fork();
+  if (child == -1)
+    throw std::runtime_error(std::string("Failed to fork: ") +
+                             strerror(errno));
+  if (child == 0) {
+    execve(executable.c_str(), const_cast<char *const *>(cArgs.data()),
+           const_cast<char *const *>(cEnv.data()));
+    std::cerr << "Unexpected error while running executable: "
+              << strerror(errno) << "\n";
+    exit(EXIT_FAILURE);
+  }
+
+  // Kernels without pidfd run the application without a time limit.
+  const int pidFd = timeout.count() != 0
+                        ? static_cast<int>(syscall(SYS_pidfd_open, child, 0))
+                        : -1;
+  if (pidFd != -1) {
+    pollfd fd = {pidFd, POLLIN, 0};
+    const auto ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+    int res = 0;
+    while ((res = poll(&fd, 1, static_cast<int>(ms.count()))) == -1 &&
+           errno == EINTR)
+      ;
+    close(pidFd);
+    if (res == 0) {
+      for (pid_t pid : getProcessTree(child))
+        kill(pid, SIGKILL);
+      waitpid(child, nullptr, 0);
+      throw timeoutError(timeout);
+    }
+  }
+
+  int status = 0;
+  while (waitpid(child, &status, 0) == -1 && errno == EINTR)
+    ;
+  if (WIFSIGNALED(status))
+    return WTERMSIG(status);
+  return WEXITSTATUS(status);
+}
+
 void replay(const options &opts) {
   std::filesystem::path tracePath;
   bool hasCLI = true;
 
+  std::unique_ptr<dpcpp_trace::Archive> archive;
+  std::unique_ptr<dpcpp_trace::ArchiveCache> archiveCache;
+
   if (std::filesystem::is_directory(opts.input())) {
     tracePath = opts.input();
     hasCLI = false;
+  } else if (dpcpp_trace::Archive::isArchive(opts.input())) {
+    if (opts.print_only()) {
+      throw std::runtime_error(
+          "--print-only is not supported for archives, unpack it first");
+    }
+    archive = std::make_unique<dpcpp_trace::Archive>(opts.input());
+    tracePath = fs::temp_directory_path() /
+                ("dpcpp_trace_replay_" + std::to_string(getpid()));
+    archiveCache = std::make_unique<dpcpp_trace::ArchiveCache>(
+        *archive, tracePath, opts.replay_cache_size());
+    extractTraceFiles(*archive, *archiveCache);
+    hasCLI = false;
   } else {
     tracePath = opts.output();
   }
@@ -47,6 +279,35 @@ void replay(const options &opts) {
         "Command line arguments are not supported for packed reproducers");
   }
 
+  const bool inProcess = opts.replay_in_process() && packedReproducer;
+  if (inProcess) {
+    // Files are not extracted on demand without a tracer.
+    if (archiveCache) {
+      for (const auto &entry : archive->entries()) {
+        if (!entry.isDirectory)
+          archiveCache->extract(entry.path, /*pinned*/ true);
+      }
+    }
+  }
+
+  std::shared_ptr<dpcpp_trace::MappedFile> redirectTableFile;
+  dpcpp_trace::redirect_table::View redirectTable;
+  if (packedReproducer) {
+    if (!fs::exists(tracePath / kRedirectTableName))
+      writeRedirectTable(tracePath);
+    dpcpp_trace::MappedFileOptions mappingOptions;
+    mappingOptions.access = dpcpp_trace::MappedFileOptions::Access::Random;
+    mappingOptions.populate = true;
+    redirectTableFile = std::make_shared<dpcpp_trace::MappedFile>(
+        tracePath / kRedirectTableName, mappingOptions);
+    redirectTable = dpcpp_trace::redirect_table::View{
+        redirectTableFile->begin(), redirectTableFile->size()};
+    if (!redirectTable.valid())
+      throw std::runtime_error("Invalid " + std::string(kRedirectTableName));
+    if (inProcess)
+      linkRedirectLibraries(tracePath, redirectTable);
+  }
+
   std::string executable;
   std::vector<std::string> execArgs;
 
@@ -62,7 +323,12 @@ void replay(const options &opts) {
     std::transform(opts.args().begin(), opts.args().end(),
                    std::back_inserter(execArgs), toString);
   } else {
-    if (packedReproducer) {
+    if (archiveCache) {
+      const fs::path exePath = fs::path{kPackedDataPath} / "0";
+      executable = archiveCache->extract(exePath.string(), /*pinned*/ true);
+      fs::permissions(executable, fs::perms::owner_exec,
+                      fs::perm_options::add);
+    } else if (packedReproducer) {
       executable = opts.input() / kPackedDataPath / "0";
     } else {
       executable = replayConfig[kReplayExecutable].get<std::string>();
@@ -88,12 +354,23 @@ void replay(const options &opts) {
   hasROCm = replayConfig[kHasROCmPlugin].get<bool>();
 
   std::string ldLibraryPath = "LD_LIBRARY_PATH=";
+  if (inProcess)
+    ldLibraryPath += fs::absolute(tracePath / kRedirectLibsPath).string() + ":";
   ldLibraryPath += (opts.location() / ".." / "lib").string() + ":";
 
+  // Redirection is preloaded only for in-process replay, so that tracer-based
+  // replay and RUNPATH lookups of the application are not affected.
+  const std::string preload =
+      inProcess ? "LD_PRELOAD=libsystem_intercept.so:libsystem_redirect.so"
+                : "LD_PRELOAD=libsystem_intercept.so";
+  const std::string redirectTableVar =
+      std::string(kRedirectTableEnvVar) + "=" +
+      fs::absolute(tracePath / kRedirectTableName).string();
+
   if (opts.print_only()) {
     fmt::print("{} \\\n", outPath);
     fmt::print("{}$LD_LIBRARY_PATH \\\n", ldLibraryPath);
-    fmt::print("LD_PRELOAD=libsystem_intercept.so \\\n");
+    fmt::print("{} \\\n", preload);
     if (hasOpenCL)
       fmt::print("SYCL_OVERRIDE_PI_OPENCL=libplugin_replay.so \\\n");
     if (hasLevelZero)
@@ -102,6 +379,10 @@ void replay(const options &opts) {
       fmt::print("SYCL_OVERRIDE_PI_CUDA=libplugin_replay.so \\\n");
     if (hasROCm)
       fmt::print("SYCL_OVERRIDE_PI_ROCM=libplugin_replay.so \\\n");
+    if (opts.replay_tolerant())
+      fmt::print("{}=1 \\\n", kReplayTolerantEnvVar);
+    if (inProcess)
+      fmt::print("{} \\\n", redirectTableVar);
     fmt::print("{}", executable);
     for (auto &arg : execArgs | std::views::drop(1)) {
       fmt::print(" {} ", arg);
@@ -138,7 +419,7 @@ void replay(const options &opts) {
       fullLDPath += std::string(std::getenv("LD_LIBRARY_PATH"));
     }
   }
-  env.emplace_back("LD_PRELOAD=libsystem_intercept.so");
+  env.push_back(preload);
   if (hasOpenCL)
     env.emplace_back("SYCL_OVERRIDE_PI_OPENCL=libplugin_replay.so");
   if (hasLevelZero)
@@ -149,52 +430,84 @@ void replay(const options &opts) {
     env.emplace_back("SYCL_OVERRIDE_PI_ROCM=libplugin_replay.so");
   env.push_back(fullLDPath);
   env.push_back(outPath);
+  if (opts.replay_tolerant())
+    env.push_back(std::string(kReplayTolerantEnvVar) + "=1");
+  if (inProcess)
+    env.push_back(redirectTableVar);
 
-  dpcpp_trace::NativeTracer tracer;
-
-  if (packedReproducer) {
-    json replayFileMap;
+  fs::path benchDir;
+  if (opts.replay_bench()) {
+    benchDir = fs::temp_directory_path() /
+               ("dpcpp_trace_bench_" + std::to_string(getpid()));
+    fs::create_directories(benchDir);
+    env.push_back(std::string(kReplayBenchEnvVar) + "=" + benchDir.string());
+    env.push_back(std::string(kReplayFastEnvVar) + "=1");
+  }
 
-    std::ifstream fileMap{tracePath / kReplayFileMapConfigName};
-    fileMap >> replayFileMap;
-    fileMap.close();
+  std::function<void(dpcpp_trace::Tracer &)> setupTracer =
+      [](dpcpp_trace::Tracer &) {};
 
+  if (packedReproducer && !inProcess) {
+    // The mapping is kept alive by the hooks.
     const auto findSuitableReplacement =
-        [=](std::string_view name) -> std::string {
-      const fs::path basePath = tracePath / kPackedDataPath;
-      if (name.find(".so") != std::string::npos) {
-        // Linux does not check for library locations, that do not exist.
-        // We need to be a bit more creative here.
-        std::string libName = fs::path(name).filename().string();
-        for (const auto &el : replayFileMap.items()) {
-          std::string cand = el.key();
-          if (cand.find(libName) != std::string::npos) {
-            return basePath / el.value();
-          }
-        }
-      } else {
-        if (replayFileMap.contains(name)) {
-          return basePath / replayFileMap[std::string{name}];
-        }
+        [=, file = redirectTableFile](std::string_view name) -> std::string {
+      const char *replacement = redirectTable.find(name);
+      if (!replacement)
+        return "";
+      return (tracePath / replacement).string();
+    };
+
+    // Files of archives are extracted right before the syscall, that
+    // accesses them, is resumed.
+    // Seccomp tracer may resolve files from several threads.
+    dpcpp_trace::ArchiveCache *cache = archiveCache.get();
+    auto cacheMutex = std::make_shared<std::mutex>();
+    const auto resolve = [=](std::string_view filename) -> std::string {
+      std::string replacement = findSuitableReplacement(filename);
+      if (cache) {
+        std::lock_guard lock{*cacheMutex};
+        cache->onAccess(replacement.empty() ? filename : replacement);
       }
-      return "";
+      return replacement;
+    };
+
+    setupTracer = [=](dpcpp_trace::Tracer &tracer) {
+      tracer.onFileOpen(
+          [=](std::string_view filename, const dpcpp_trace::OpenHandler &h) {
+            std::string replacement = resolve(filename);
+            if (!replacement.empty())
+              h.replaceFilename(replacement);
+          });
+      tracer.onStat(
+          [=](std::string_view filename, const dpcpp_trace::StatHandler &h) {
+            std::string replacement = resolve(filename);
+            if (!replacement.empty())
+              h.replaceFilename(replacement);
+          });
     };
+  }
+
+  const auto runOnce = [&]() {
+    if (inProcess)
+      return runUntraced(executable, execArgs, env, opts.timeout());
+
+    std::unique_ptr<dpcpp_trace::Tracer> tracer =
+        dpcpp_trace::makeTracer(opts.tracer());
+    setupTracer(*tracer);
+    tracer->launch(executable, execArgs, env);
+    tracer->start();
+    if (opts.timeout().count() != 0 && !tracer->waitFor(opts.timeout())) {
+      tracer->kill();
+      tracer->wait();
+      throw timeoutError(opts.timeout());
+    }
+    return tracer->wait();
+  };
+
+  if (opts.replay_bench()) {
+    runBench(opts, tracePath, benchDir, runOnce);
+    return;
+  }
 
-    tracer.onFileOpen(
-        [=](std::string_view filename, const dpcpp_trace::OpenHandler &h) {
-          std::string replacement = findSuitableReplacement(filename);
-          if (!replacement.empty())
-            h.replaceFilename(replacement);
-        });
-    tracer.onStat(
-        [=](std::string_view filename, const dpcpp_trace::StatHandler &h) {
-          std::string replacement = findSuitableReplacement(filename);
-          if (!replacement.empty())
-            h.replaceFilename(replacement);
-        });
-  }
-
-  tracer.launch(executable, execArgs, env);
-  tracer.start();
-  tracer.wait();
+  runOnce();
 }
@@ -1,54 +1,180 @@
 #include "common.hpp"
 #include "constants.hpp"
+#include "utils/Archive.hpp"
 #include "utils/Compression.hpp"
+#include "utils/Hash.hpp"
 #include "utils/MappedFile.hpp"
-#include "utils/MemoryView.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
 #include <filesystem>
+#include <fnmatch.h>
 #include <fstream>
 #include <iostream>
-#include <nlohmann/json.hpp>
+#include <mutex>
+#include <stdexcept>
 #include <string>
-#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
-using json = nlohmann::json;
 namespace fs = std::filesystem;
 using namespace dpcpp_trace;
 
-void parseV0(MappedFile &mapping, fs::path output) {
-  auto mapIt = mapping.begin() + 1;
+static bool isSelected(const Archive::Entry &entry,
+                       const std::vector<std::string> &patterns) {
+  if (patterns.empty())
+    return true;
+  for (const auto &pattern : patterns) {
+    if (fnmatch(pattern.c_str(), entry.path.c_str(), 0) == 0)
+      return true;
+  }
+  return false;
+}
+
+namespace {
+// Frame of a file, that is decompressed by a single worker. v0 files are a
+// single frame of unknown size.
+struct ExtractJob {
+  size_t entry;
+  size_t frame;
+};
+} // namespace
+
+static void writeAll(int fd, const uint8_t *data, size_t size,
+                     uint64_t offset) {
+  while (size > 0) {
+    const ssize_t written = pwrite(fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("Failed to write file: ") +
+                               std::strerror(errno));
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+static void extractFrame(const Archive &archive, const Archive::Entry &entry,
+                         size_t frameIdx, const fs::path &path,
+                         Compression &comp) {
+  if (archive.version() == 0) {
+    std::ofstream os{path, std::ios::binary};
+    archive.extract(entry, os, comp);
+    return;
+  }
+
+  const Buffer buf = comp.uncompress(archive.frameData(entry.frames[frameIdx]),
+                                     kArchiveFrameSize);
+  const uint64_t offset = frameIdx * kArchiveFrameSize;
+  if (offset + buf.size() > entry.size)
+    throw std::runtime_error("Packed trace is corrupted");
+
+  const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd == -1)
+    throw std::runtime_error("Failed to open " + path.string());
+  try {
+    writeAll(fd, buf.data(), buf.size(), offset);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+}
+
+// Frames are written out of order, so hashes are computed over the complete
+// files, that are still in page cache.
+static void verifyFile(const Archive::Entry &entry, const fs::path &path) {
+  if (fs::file_size(path) != entry.size)
+    throw std::runtime_error("Size mismatch for " + entry.path);
+  MappedFileOptions mappingOptions;
+  mappingOptions.access = MappedFileOptions::Access::Sequential;
+  MappedFile mapping{path, mappingOptions};
+  if (xxh64(mapping.span()) != entry.hash)
+    throw std::runtime_error("Checksum mismatch for " + entry.path);
+}
+
+static void extractEntries(const Archive &archive, const options &opts) {
+  const auto &entries = archive.entries();
+
+  // Index pass: create the directory tree and empty files of the final size,
+  // so that workers only have to write frames at their offsets.
+  std::vector<ExtractJob> jobs;
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto &entry = entries[i];
+    if (!isSelected(entry, opts.unpack_only()))
+      continue;
+
+    const fs::path path = opts.output() / entry.path;
+    if (entry.isDirectory) {
+      fs::create_directories(path);
+      continue;
+    }
 
-  Compression comp;
+    // Parent directories are not listed before their contents, if some
+    // files are filtered out.
+    fs::create_directories(path.parent_path());
+    std::ofstream{path, std::ios::binary}.close();
+    fs::resize_file(path, entry.size);
 
-  while (mapIt != mapping.end()) {
-    uint8_t kind = *mapIt;
-    mapIt++;
+    for (size_t k = 0; k < entry.frames.size(); k++)
+      jobs.push_back(ExtractJob{i, k});
+  }
 
-    if (kind == 0) {
-      uint64_t size = *reinterpret_cast<uint64_t *>(mapIt);
-      mapIt += sizeof(size);
-      std::string_view path{reinterpret_cast<char *>(mapIt), size};
-      mapIt += size;
+  std::vector<std::atomic<size_t>> remainingFrames(entries.size());
+  for (const auto &job : jobs)
+    remainingFrames[job.entry]++;
 
-      fs::create_directory(output / path);
-    } else if (kind == 1) {
-      uint64_t size = *reinterpret_cast<uint64_t *>(mapIt);
-      mapIt += sizeof(size);
-      std::string_view path{reinterpret_cast<char *>(mapIt), size};
-      mapIt += size;
+  size_t numWorkers = opts.jobs();
+  if (numWorkers == 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+  numWorkers = std::min(numWorkers, jobs.size());
 
-      uint64_t length = *reinterpret_cast<uint64_t *>(mapIt);
-      mapIt += sizeof(length);
+  std::atomic<size_t> next = 0;
+  std::mutex errorMutex;
+  std::exception_ptr error;
 
-      auto buf = comp.uncompress(MemoryView{mapIt, length});
-      mapIt += length;
+  const auto work = [&] {
+    Compression comp;
+    comp.setDictionary(archive.dictionary());
+    while (true) {
+      const size_t idx = next.fetch_add(1);
+      if (idx >= jobs.size())
+        return;
 
-      std::ofstream os{output / path};
-      os.write(buf.as<char>(), buf.size());
-      os.close();
+      const auto &entry = entries[jobs[idx].entry];
+      const fs::path path = opts.output() / entry.path;
+      try {
+        extractFrame(archive, entry, jobs[idx].frame, path, comp);
+        if (remainingFrames[jobs[idx].entry].fetch_sub(1) == 1 &&
+            archive.version() > 0)
+          verifyFile(entry, path);
+      } catch (...) {
+        std::lock_guard lock{errorMutex};
+        if (!error)
+          error = std::current_exception();
+        // Make other workers stop.
+        next = jobs.size();
+        return;
+      }
     }
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    for (size_t i = 0; i < numWorkers; i++)
+      workers.emplace_back(work);
   }
+
+  if (error)
+    std::rethrow_exception(error);
 }
 
 void unpack(const options &opts) {
@@ -62,15 +188,16 @@ void unpack(const options &opts) {
     exit(EXIT_FAILURE);
   }
 
-  fs::create_directory(opts.output());
-
-  MappedFile mapping{opts.input()};
-
-  uint8_t version = *mapping.begin();
-  if (version == 0) {
-    parseV0(mapping, opts.output());
-  } else {
-    std::cerr << "Unknown package verion " << version << "\n";
+  try {
+    // Frames are extracted roughly in order, unless only some files are.
+    const auto access = opts.unpack_only().empty()
+                            ? MappedFileOptions::Access::Sequential
+                            : MappedFileOptions::Access::Random;
+    Archive archive{opts.input(), access};
+    fs::create_directory(opts.output());
+    extractEntries(archive, opts);
+  } catch (std::runtime_error &err) {
+    std::cerr << err.what() << "\n";
     exit(EXIT_FAILURE);
   }
 }
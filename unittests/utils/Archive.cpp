@@ -0,0 +1,162 @@
+#include <catch2/catch.hpp>
+
+#include "utils/Archive.hpp"
+#include "utils/ArchiveCache.hpp"
+#include "utils/Compression.hpp"
+#include "utils/Hash.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace dpcpp_trace;
+namespace fs = std::filesystem;
+
+static std::string readFile(const fs::path &path) {
+  std::ifstream is{path, std::ios::binary};
+  std::stringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+// Writes an archive with a single frame per file.
+static void writeArchive(const fs::path &path,
+                         const std::map<std::string, std::string> &files) {
+  Compression comp;
+  std::ofstream os{path, std::ios::binary};
+  Archive::writeHeader(os, Buffer{0});
+
+  std::vector<Archive::Entry> entries;
+  Archive::Entry dir;
+  dir.path = "buffers";
+  dir.isDirectory = true;
+  entries.push_back(dir);
+
+  for (const auto &[name, contents] : files) {
+    Archive::Entry entry;
+    entry.path = name;
+    entry.size = contents.size();
+    entry.hash = xxh64(contents);
+    const Buffer compressed = comp.compress(contents);
+    entry.frames.push_back(Archive::Frame{
+        static_cast<uint64_t>(os.tellp()), compressed.size()});
+    os.write(compressed.as<char>(), compressed.size());
+    entries.push_back(std::move(entry));
+  }
+
+  Archive::writeDirectory(os, entries);
+}
+
+TEST_CASE("archive files are extracted on demand", "[archive]") {
+  const fs::path tmpDir =
+      fs::temp_directory_path() /
+      ("dpcpp_trace_archive_test_" + std::to_string(getpid()));
+  fs::create_directories(tmpDir);
+  const fs::path archivePath = tmpDir / "trace.pack";
+
+  const std::map<std::string, std::string> files = {
+      {"main.pi_trace", std::string(100, 't')},
+      {"buffers/a.mem", std::string(1000, 'a')},
+      {"buffers/b.mem", std::string(1000, 'b')},
+      {"buffers/c.mem", std::string(1000, 'c')},
+  };
+  writeArchive(archivePath, files);
+
+  REQUIRE(Archive::isArchive(archivePath));
+  Archive archive{archivePath};
+  REQUIRE(archive.version() == kArchiveVersion);
+  REQUIRE(archive.entries().size() == 5);
+  REQUIRE(archive.find("buffers/b.mem") != nullptr);
+  REQUIRE(archive.find("buffers/d.mem") == nullptr);
+
+  SECTION("extract") {
+    Compression comp;
+    std::ostringstream os;
+    archive.extract(*archive.find("buffers/b.mem"), os, comp);
+    REQUIRE(os.str() == files.at("buffers/b.mem"));
+  }
+  SECTION("cache") {
+    const fs::path root = tmpDir / "root";
+    {
+      ArchiveCache cache{archive, root, 2000};
+      REQUIRE(fs::is_directory(root / "buffers"));
+      REQUIRE(!fs::exists(root / "buffers/a.mem"));
+
+      cache.extract("main.pi_trace", /*pinned*/ true);
+      cache.onAccess((root / "buffers/a.mem").string());
+      cache.onAccess((root / "buffers/b.mem").string());
+      cache.onAccess("/elsewhere/buffers/c.mem");
+      REQUIRE(readFile(root / "buffers/a.mem") == files.at("buffers/a.mem"));
+      REQUIRE(!fs::exists(root / "buffers/c.mem"));
+
+      // a.mem is used more recently than b.mem, so b.mem is evicted.
+      cache.extract("buffers/a.mem");
+      cache.extract("buffers/c.mem");
+      REQUIRE(cache.size() == 2000);
+      REQUIRE(fs::exists(root / "buffers/a.mem"));
+      REQUIRE(!fs::exists(root / "buffers/b.mem"));
+      REQUIRE(fs::exists(root / "buffers/c.mem"));
+      REQUIRE(fs::exists(root / "main.pi_trace"));
+    }
+    REQUIRE(!fs::exists(root));
+  }
+  SECTION("corrupted") {
+    std::ofstream os{tmpDir / "bad.pack", std::ios::binary};
+    os << "\1not an archive";
+    os.close();
+    REQUIRE(!Archive::isArchive(tmpDir / "bad.pack"));
+    REQUIRE_THROWS_AS(Archive{tmpDir / "bad.pack"}, std::runtime_error);
+  }
+
+  fs::remove_all(tmpDir);
+}
+
+TEST_CASE("archive rejects out of range offsets", "[archive]") {
+  const fs::path path =
+      fs::temp_directory_path() /
+      ("dpcpp_trace_malformed_" + std::to_string(getpid()) + ".pack");
+  writeArchive(path, {{"a.mem", std::string(1000, 'a')}});
+  const std::string valid = readFile(path);
+
+  const auto patch = [&](size_t pos, uint64_t value) {
+    std::string data = valid;
+    std::memcpy(data.data() + pos, &value, sizeof(value));
+    std::ofstream{path, std::ios::binary} << data;
+  };
+
+  // Trailer is directory offset, directory size and magic.
+  const size_t trailer = valid.size() - 3 * sizeof(uint64_t);
+  uint64_t directory;
+  std::memcpy(&directory, valid.data() + trailer, sizeof(directory));
+  // Number of entries, "buffers" directory, "a.mem" up to its frame.
+  const size_t frame = directory + 8 + (1 + 8 + 7 + 32) + (1 + 8 + 5 + 32);
+
+  SECTION("directory") {
+    patch(trailer + sizeof(uint64_t), UINT64_MAX - 8);
+  }
+  SECTION("frame") {
+    patch(frame + sizeof(uint64_t), UINT64_MAX - 8);
+  }
+
+  REQUIRE(!Archive::isArchive(path));
+  REQUIRE_THROWS_AS(Archive{path}, std::runtime_error);
+  fs::remove(path);
+}
+
+TEST_CASE("archive rejects frames larger than the frame size", "[archive]") {
+  const fs::path path =
+      fs::temp_directory_path() /
+      ("dpcpp_trace_large_frame_" + std::to_string(getpid()) + ".pack");
+  writeArchive(path, {{"a.mem", std::string(kArchiveFrameSize + 1, 'a')}});
+
+  Archive archive{path};
+  Compression comp;
+  std::ostringstream os;
+  REQUIRE_THROWS_AS(archive.extract(*archive.find("a.mem"), os, comp),
+                    std::runtime_error);
+  fs::remove(path);
+}
@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+
+#include "utils/Buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+using namespace dpcpp_trace;
+
+TEST_CASE("buffer is zero-initialized", "[buffer]") {
+  Buffer buf{16};
+  REQUIRE(buf.size() == 16);
+  REQUIRE(std::all_of(buf.data(), buf.data() + buf.size(),
+                      [](uint8_t c) { return c == 0; }));
+
+  std::memset(buf.data(), 0xff, buf.size());
+  buf.resize(4);
+  buf.resize(32);
+  REQUIRE(buf.data()[3] == 0xff);
+  REQUIRE(std::all_of(buf.data() + 4, buf.data() + buf.size(),
+                      [](uint8_t c) { return c == 0; }));
+}
+
+TEST_CASE("buffer keeps contents when growing", "[buffer]") {
+  Buffer buf = Buffer::uninitialized(3);
+  std::memcpy(buf.data(), "abc", 3);
+  buf.resizeUninitialized(1000);
+  REQUIRE(buf.capacity() >= 1000);
+  REQUIRE(std::memcmp(buf.data(), "abc", 3) == 0);
+
+  buf.resizeUninitialized(0);
+  REQUIRE(buf.size() == 0);
+  REQUIRE(buf.capacity() >= 1000);
+
+  Buffer moved = std::move(buf);
+  REQUIRE(moved.capacity() >= 1000);
+  REQUIRE(buf.data() == nullptr);
+}
+
+TEST_CASE("buffer pool reuses memory", "[buffer]") {
+  BufferPool pool;
+
+  const uint8_t *ptr = nullptr;
+  {
+    Buffer buf = pool.acquire(1 << 20);
+    ptr = buf.data();
+  }
+
+  // Smaller requests are served by the cached block.
+  Buffer buf = pool.acquire(1000);
+  REQUIRE(buf.data() == ptr);
+  REQUIRE(buf.size() == 1000);
+
+  Buffer other = pool.acquire(1000);
+  REQUIRE(other.data() != ptr);
+}
+
+TEST_CASE("pooled buffers outlive their pool", "[buffer]") {
+  auto pool = std::make_unique<BufferPool>();
+  Buffer buf = pool->acquire(100);
+  pool.reset();
+
+  std::memset(buf.data(), 1, buf.size());
+  buf.resizeUninitialized(1 << 16);
+  REQUIRE(buf.data()[99] == 1);
+}
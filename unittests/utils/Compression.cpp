@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+
+#include "utils/Compression.hpp"
+#include "utils/MemoryView.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace dpcpp_trace;
+
+// Several output chunks of decompression into streams, with some repetition
+// to compress.
+static std::string makeData() {
+  std::string data;
+  for (size_t i = 0; data.size() < 1024 * 1024; i++)
+    data += std::to_string(i * 7919 % 1000) + ",";
+  return data;
+}
+
+TEST_CASE("compression round trips", "[compression]") {
+  const std::string data = makeData();
+  Compression comp;
+
+  SECTION("buffers") {
+    Buffer compressed = comp.compress(data);
+    REQUIRE(compressed.size() < data.size());
+    Buffer uncompressed =
+        comp.uncompress(MemoryView{compressed.data(), compressed.size()});
+    REQUIRE(std::string(uncompressed.as<char>(), uncompressed.size()) == data);
+  }
+  SECTION("buffers larger than expected") {
+    const Buffer compressed = comp.compress(data);
+    REQUIRE_THROWS_AS(
+        comp.uncompress(MemoryView{compressed.data(), compressed.size()},
+                        data.size() - 1),
+        std::runtime_error);
+  }
+  SECTION("streams") {
+    const Buffer compressed = comp.compress(data);
+    const MemoryView compView{compressed.data(), compressed.size()};
+
+    std::ostringstream uncompressed;
+    REQUIRE(comp.uncompress(compView, uncompressed) == data.size());
+    REQUIRE(uncompressed.str() == data);
+  }
+  SECTION("empty stream") {
+    const Buffer compressed = comp.compress(std::string{});
+
+    std::ostringstream uncompressed;
+    REQUIRE(comp.uncompress(MemoryView{compressed.data(), compressed.size()},
+                            uncompressed) == 0);
+  }
+  SECTION("truncated stream") {
+    const Buffer compressed = comp.compress(data);
+
+    std::ostringstream uncompressed;
+    REQUIRE_THROWS_AS(
+        comp.uncompress(MemoryView{compressed.data(), compressed.size() / 2},
+                        uncompressed),
+        std::runtime_error);
+  }
+}
+
+TEST_CASE("compression uses trained dictionaries", "[compression]") {
+  // Small JSON-like records, that share most of their contents.
+  std::vector<Buffer> samples;
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 1000; i++) {
+    std::string input = "{\"function\": \"piEnqueueKernelLaunch\", \"id\": " +
+                        std::to_string(i) + ", \"thread\": " +
+                        std::to_string(i % 7) + ", \"result\": \"PI_SUCCESS\"}";
+    Buffer sample{input.size()};
+    std::copy(input.begin(), input.end(), sample.as<char>());
+    samples.push_back(std::move(sample));
+    inputs.push_back(std::move(input));
+  }
+
+  const Buffer dict = Compression::trainDictionary(samples, 4096);
+  REQUIRE(dict.size() > 0);
+  REQUIRE(dict.size() <= 4096);
+
+  Compression plain;
+  Compression comp;
+  comp.setDictionary(MemoryView{dict.data(), dict.size()});
+
+  const Buffer plainFrame = plain.compress(inputs[42]);
+  const Buffer dictFrame = comp.compress(inputs[42]);
+  REQUIRE(dictFrame.size() < plainFrame.size());
+
+  Buffer decompressed = comp.uncompress(
+      MemoryView{dictFrame.data(), dictFrame.size()});
+  REQUIRE(std::string(decompressed.as<char>(), decompressed.size()) ==
+          inputs[42]);
+
+  // Frames without dictionary are still readable.
+  decompressed = comp.uncompress(
+      MemoryView{plainFrame.data(), plainFrame.size()});
+  REQUIRE(std::string(decompressed.as<char>(), decompressed.size()) ==
+          inputs[42]);
+
+  REQUIRE_THROWS_AS(
+      plain.uncompress(MemoryView{dictFrame.data(), dictFrame.size()}),
+      std::runtime_error);
+
+  SECTION("too few samples") {
+    samples.erase(samples.begin() + 1, samples.end());
+    REQUIRE(Compression::trainDictionary(samples, 4096).size() == 0);
+  }
+}
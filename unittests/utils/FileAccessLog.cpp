@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+
+#include "utils/FileAccessLog.hpp"
+
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace dpcpp_trace;
+
+TEST_CASE("file access log keeps one entry per path", "[file_access_log]") {
+  FileAccessLog log;
+  log["/usr/lib/libfoo.so"].flags |= O_RDONLY | O_CLOEXEC;
+  log["/missing/libfoo.so"].flags |= O_RDONLY;
+  log["/usr/lib/libfoo.so"].flags |= O_RDWR;
+
+  REQUIRE(log.size() == 2);
+  REQUIRE(log.entries()[0].path == "/usr/lib/libfoo.so");
+  REQUIRE(log.entries()[0].flags == (O_RDWR | O_CLOEXEC));
+  REQUIRE(log.entries()[1].path == "/missing/libfoo.so");
+}
+
+TEST_CASE("file access log can be read back", "[file_access_log]") {
+  const fs::path file = fs::temp_directory_path() / "file_access_log_test";
+
+  FileAccessLog log;
+  FileAccess &lib = log["/usr/lib/libfoo.so"];
+  lib.flags = O_RDONLY | O_CLOEXEC;
+  lib.opened = true;
+  lib.regular = true;
+  lib.device = 2049;
+  lib.inode = 1234567;
+  lib.size = 42;
+  lib.modificationTimeNs = 1'700'000'000'123'456'789;
+  log["/missing/libfoo.so"].flags = O_RDONLY;
+  log.write(file);
+
+  const std::vector<FileAccess> entries = FileAccessLog::read(file);
+  fs::remove(file);
+
+  REQUIRE(entries.size() == 2);
+  REQUIRE(entries[0].path == "/usr/lib/libfoo.so");
+  REQUIRE(entries[0].flags == (O_RDONLY | O_CLOEXEC));
+  REQUIRE(entries[0].opened);
+  REQUIRE(entries[0].regular);
+  REQUIRE(entries[0].device == 2049);
+  REQUIRE(entries[0].inode == 1234567);
+  REQUIRE(entries[0].size == 42);
+  REQUIRE(entries[0].modificationTimeNs == 1'700'000'000'123'456'789);
+  REQUIRE(entries[1].path == "/missing/libfoo.so");
+  REQUIRE_FALSE(entries[1].opened);
+  REQUIRE_FALSE(entries[1].regular);
+}
+
+TEST_CASE("file access log rejects foreign files", "[file_access_log]") {
+  const fs::path file = fs::temp_directory_path() / "file_access_log_foreign";
+  {
+    std::ofstream os{file};
+    os << "[\"/usr/lib/libfoo.so\"]";
+  }
+  REQUIRE_THROWS_AS(FileAccessLog::read(file), std::runtime_error);
+  fs::remove(file);
+}
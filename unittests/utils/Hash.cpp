@@ -0,0 +1,27 @@
+#include <catch2/catch.hpp>
+
+#include "utils/Hash.hpp"
+
+#include <string>
+#include <string_view>
+
+using namespace dpcpp_trace;
+
+TEST_CASE("xxh64 matches reference values", "[hash]") {
+  REQUIRE(xxh64(std::string_view{""}) == 0xEF46DB3751D8E999ull);
+  REQUIRE(xxh64(std::string_view{"abc"}) == 0x44BC2CF5AD770999ull);
+}
+
+TEST_CASE("xxh64 does not depend on update sizes", "[hash]") {
+  std::string data;
+  for (int i = 0; i < 1000; i++)
+    data += std::to_string(i);
+
+  const uint64_t expected = xxh64(data);
+  for (size_t step : {1, 3, 7, 31, 32, 33, 100}) {
+    XXHash64 hash;
+    for (size_t i = 0; i < data.size(); i += step)
+      hash.update(std::string_view{data}.substr(i, step));
+    REQUIRE(hash.digest() == expected);
+  }
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+
+#include "api_call.pb.h"
+#include "constants.hpp"
+#include "info_index.hpp"
+
+#include <CL/sycl/detail/pi.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+using namespace sycl::detail;
+
+inline constexpr uint64_t kInfoTestEvent = 0x1000;
+
+static void writeCall(std::ostream &os, const dpcpp_trace::APICall &call) {
+  std::string data;
+  call.SerializeToString(&data);
+  const uint32_t size = data.size();
+  os.write(reinterpret_cast<const char *>(&size), sizeof(size));
+  os.write(data.data(), size);
+}
+
+static void writeContextCreate(std::ostream &os) {
+  dpcpp_trace::APICall call;
+  call.set_function_id(static_cast<uint32_t>(PiApiKind::piContextCreate));
+  for (int i = 0; i < 6; i++)
+    call.add_args()->set_int_val(0);
+  call.add_small_outputs(std::string(sizeof(uint64_t), '\1'));
+  writeCall(os, call);
+}
+
+// Recorded piEventGetInfo call of the status of kInfoTestEvent.
+static void writeEventStatus(std::ostream &os, uint64_t time,
+                             pi_int32 status) {
+  dpcpp_trace::APICall call;
+  call.set_function_id(static_cast<uint32_t>(PiApiKind::piEventGetInfo));
+  call.set_time_start(time);
+  call.add_args()->set_int_val(kInfoTestEvent);
+  call.add_args()->set_int_val(PI_EVENT_INFO_COMMAND_EXECUTION_STATUS);
+  call.add_args()->set_int_val(sizeof(status));
+  call.add_args()->set_int_val(0x2000);
+  call.add_args()->set_int_val(0);
+  call.add_small_outputs(
+      std::string(reinterpret_cast<const char *>(&status), sizeof(status)));
+  writeCall(os, call);
+}
+
+static pi_int32 getStatus(InfoIndex &index) {
+  const InfoIndex::Answer *answer = index.find(
+      static_cast<uint32_t>(PiApiKind::piEventGetInfo), kInfoTestEvent, 0,
+      PI_EVENT_INFO_COMMAND_EXECUTION_STATUS, true, false);
+  REQUIRE(answer != nullptr);
+  pi_int32 status = -1;
+  REQUIRE(answer->apply(sizeof(status), &status, nullptr));
+  return status;
+}
+
+TEST_CASE("info index returns changing answers in recorded order",
+          "[InfoIndex]") {
+  const fs::path dir = fs::temp_directory_path() / "info_index_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  {
+    // Answers of different threads are ordered by time.
+    std::ofstream main{dir / (std::string{"main"} + kPiTraceExt),
+                       std::ios::binary};
+    writeContextCreate(main);
+    writeEventStatus(main, 10, PI_EVENT_RUNNING);
+    writeEventStatus(main, 30, PI_EVENT_COMPLETE);
+    std::ofstream worker{dir / (std::string{"main_0"} + kPiTraceExt),
+                         std::ios::binary};
+    writeEventStatus(worker, 20, PI_EVENT_SUBMITTED);
+  }
+
+  InfoIndex index;
+  index.build(dir);
+  fs::remove_all(dir);
+
+  REQUIRE(index.hasHandles());
+  REQUIRE(getStatus(index) == PI_EVENT_RUNNING);
+  REQUIRE(getStatus(index) == PI_EVENT_SUBMITTED);
+  REQUIRE(getStatus(index) == PI_EVENT_COMPLETE);
+  // The last answer is repeated for queries, that were not recorded.
+  REQUIRE(getStatus(index) == PI_EVENT_COMPLETE);
+}
+
+TEST_CASE("info index skips answers without requested outputs",
+          "[InfoIndex]") {
+  const fs::path dir = fs::temp_directory_path() / "info_index_size_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  {
+    std::ofstream main{dir / (std::string{"main"} + kPiTraceExt),
+                       std::ios::binary};
+    writeContextCreate(main);
+
+    // Runtime asks for the size of the value before the value.
+    dpcpp_trace::APICall call;
+    call.set_function_id(static_cast<uint32_t>(PiApiKind::piEventGetInfo));
+    call.set_time_start(10);
+    call.add_args()->set_int_val(kInfoTestEvent);
+    call.add_args()->set_int_val(PI_EVENT_INFO_COMMAND_EXECUTION_STATUS);
+    call.add_args()->set_int_val(0);
+    call.add_args()->set_int_val(0);
+    call.add_args()->set_int_val(0x3000);
+    const uint64_t size = sizeof(pi_int32);
+    call.add_small_outputs(
+        std::string(reinterpret_cast<const char *>(&size), sizeof(size)));
+    writeCall(main, call);
+    writeEventStatus(main, 20, PI_EVENT_COMPLETE);
+  }
+
+  InfoIndex index;
+  index.build(dir);
+  fs::remove_all(dir);
+
+  // The value is requested first, so the size-only answer is skipped.
+  REQUIRE(getStatus(index) == PI_EVENT_COMPLETE);
+}
@@ -0,0 +1,63 @@
+#include <catch2/catch.hpp>
+
+#include "utils/MappedFile.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace dpcpp_trace;
+namespace fs = std::filesystem;
+
+TEST_CASE("MappedFile maps files and ranges", "[mapped_file]") {
+  const fs::path dir = fs::temp_directory_path() /
+                       ("dpcpp_trace_mapped_test_" + std::to_string(getpid()));
+  fs::create_directories(dir);
+
+  std::string contents;
+  for (int i = 0; contents.size() < 3 * 4096; i++)
+    contents += std::to_string(i) + "\n";
+  {
+    std::ofstream os{dir / "data", std::ios::binary};
+    os << contents;
+    std::ofstream{dir / "empty"};
+  }
+
+  SECTION("whole file") {
+    MappedFileOptions options;
+    options.access = MappedFileOptions::Access::Sequential;
+    options.populate = true;
+    options.hugePages = true;
+    MappedFile mapping{dir / "data", options};
+    REQUIRE(mapping.size() == contents.size());
+    REQUIRE(std::string(mapping.begin(), mapping.end()) == contents);
+    REQUIRE(mapping.subspan(5, 3).size() == 3);
+    REQUIRE(mapping.subspan(5, 3)[0] == contents[5]);
+  }
+  SECTION("sub-range at unaligned offset") {
+    MappedFileOptions options;
+    options.access = MappedFileOptions::Access::Random;
+    options.offset = 4097;
+    options.length = 100;
+    MappedFile mapping{dir / "data", options};
+    REQUIRE(mapping.size() == 100);
+    REQUIRE(std::string(mapping.span().begin(), mapping.span().end()) ==
+            contents.substr(4097, 100));
+    REQUIRE_NOTHROW(mapping.prefetch(10, 1000));
+  }
+  SECTION("empty file") {
+    MappedFile mapping{dir / "empty"};
+    REQUIRE(mapping.size() == 0);
+    REQUIRE(mapping.begin() == mapping.end());
+    REQUIRE(mapping.span().empty());
+  }
+  SECTION("range outside of file") {
+    MappedFileOptions options;
+    options.offset = contents.size() - 10;
+    options.length = 11;
+    REQUIRE_THROWS_AS(MappedFile(dir / "data", options), std::runtime_error);
+  }
+
+  fs::remove_all(dir);
+}
@@ -3,23 +3,44 @@
 #include "utils/Tracer.hpp"
 
 #include <chrono>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <set>
 #include <iostream>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
 
 inline constexpr auto kForkTestFilename = "fork_test";
 inline constexpr auto kOpenTestFilename = "open_test";
 inline constexpr auto kStatTestFilename = "stat_test";
 inline constexpr auto kReplaceTestFilename1 = "replace1_test";
 inline constexpr auto kReplaceTestFilename2 = "replace2_test";
+inline constexpr auto kPageTestFilename = "page_boundary_test";
+inline constexpr auto kChildTestFilename = "child_test";
+inline constexpr auto kResultTestFilename = "result_test";
+inline constexpr auto kIOTestFilename = "io_test";
 
 namespace fs = std::filesystem;
 using namespace dpcpp_trace;
 using namespace std::chrono_literals;
 
+// Killed processes, that were reparented, may stay zombies for a while.
+static bool isRunning(pid_t pid) {
+  std::ifstream is{"/proc/" + std::to_string(pid) + "/stat"};
+  std::string stat;
+  std::getline(is, stat);
+  const size_t nameEnd = stat.rfind(')');
+  return nameEnd != std::string::npos && nameEnd + 2 < stat.size() &&
+         stat[nameEnd + 2] != 'Z';
+}
+
 TEST_CASE("can fork processes", "[NativeTracer]") {
   const auto start = []() {
     std::this_thread::sleep_for(30ms);
@@ -142,9 +163,242 @@ TEST_CASE("can replace filenames", "[NativeTracer]") {
   REQUIRE(n == 10);
 }
 
+TEST_CASE("can read filenames at the end of a page", "[NativeTracer]") {
+  const std::string path =
+      (fs::temp_directory_path() / kPageTestFilename).string();
+
+  const auto start = [&path]() {
+    std::this_thread::sleep_for(30ms);
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    auto *mem = static_cast<char *>(mmap(nullptr, 2 * pageSize,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    munmap(mem + pageSize, pageSize);
+
+    // The terminating zero is the last byte before the unmapped page.
+    char *str = mem + pageSize - path.size() - 1;
+    std::memcpy(str, path.c_str(), path.size() + 1);
+    const int fd = open(str, O_WRONLY | O_CREAT, 0644);
+    if (fd != -1)
+      close(fd);
+  };
+
+  std::string traced;
+
+  NativeTracer tracer;
+  tracer.onFileOpen([&traced](std::string_view filename, const OpenHandler &) {
+    if (filename.ends_with(kPageTestFilename))
+      traced = filename;
+  });
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  fs::remove(path);
+
+  REQUIRE(traced == path);
+}
+
+TEST_CASE("can report results of opens", "[NativeTracer]") {
+  const fs::path file = fs::temp_directory_path() / kResultTestFilename;
+  std::ofstream{file} << 42;
+
+  const auto start = [file]() {
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    char c = 0;
+    const bool hasData = fd != -1 && read(fd, &c, 1) == 1 && c == '4';
+    open((file.string() + "_missing").c_str(), O_RDONLY);
+    exit(hasData ? 0 : 1);
+  };
+
+  long existing = 0;
+  long missing = 0;
+  int flags = 0;
+
+  NativeTracer tracer;
+  tracer.onFileOpen([&](std::string_view filename, const OpenHandler &h) {
+    if (filename == file.string()) {
+      flags = h.flags();
+      h.onReturn([&](long result) { existing = result; });
+    } else if (filename == file.string() + "_missing") {
+      h.onReturn([&](long result) { missing = result; });
+    }
+  });
+  tracer.fork(start);
+  tracer.start();
+  const int code = tracer.wait();
+  fs::remove(file);
+
+  REQUIRE(code == 0);
+  REQUIRE(existing >= 0);
+  REQUIRE(missing == -ENOENT);
+  REQUIRE((flags & O_CLOEXEC) == O_CLOEXEC);
+}
+
+TEST_CASE("can profile I/O of files", "[NativeTracer]") {
+  const fs::path file = fs::temp_directory_path() / kIOTestFilename;
+  std::ofstream{file} << "0123456789";
+
+  const auto start = [file]() {
+    const int fd = open(file.c_str(), O_RDONLY);
+    char buf[4];
+    const bool hasData = read(fd, buf, sizeof(buf)) == sizeof(buf);
+    void *data = mmap(nullptr, 10, PROT_READ, MAP_PRIVATE, fd, 0);
+    const bool mapped = data != MAP_FAILED;
+    close(fd);
+    exit(hasData && mapped ? 0 : 1);
+  };
+
+  int fd = -1;
+  long readBytes = -1;
+  size_t mappedBytes = 0;
+  bool closed = false;
+
+  NativeTracer tracer;
+  tracer.onFileOpen([&](std::string_view filename, const OpenHandler &h) {
+    if (filename == file.string())
+      h.onReturn([&](long result) { fd = static_cast<int>(result); });
+  });
+  tracer.onIO([&](const IOHandler &h) {
+    if (fd == -1 || h.fd() != fd)
+      return;
+    switch (h.kind()) {
+    case IOHandler::Kind::Read:
+      h.onReturn([&](long result) { readBytes = result; });
+      break;
+    case IOHandler::Kind::MMap:
+      mappedBytes = h.size();
+      break;
+    case IOHandler::Kind::Close:
+      closed = true;
+      break;
+    default:
+      break;
+    }
+  });
+  tracer.fork(start);
+  tracer.start();
+  const int code = tracer.wait();
+  fs::remove(file);
+
+  REQUIRE(code == 0);
+  REQUIRE(readBytes == 4);
+  REQUIRE(mappedBytes == 10);
+  REQUIRE(closed);
+}
+
+TEST_CASE("can trace child processes and threads", "[NativeTracer]") {
+  const fs::path path = fs::temp_directory_path() / kChildTestFilename;
+  std::ofstream{path} << 42;
+
+  const auto start = [&path]() {
+    std::this_thread::sleep_for(30ms);
+    std::thread thread{[&path] { std::ifstream{path}; }};
+    thread.join();
+
+    const pid_t child = fork();
+    if (child == 0) {
+      const int devNull = open("/dev/null", O_WRONLY);
+      dup2(devNull, STDOUT_FILENO);
+      execl("/bin/cat", "cat", path.c_str(), nullptr);
+      _exit(1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+  };
+
+  std::set<int> pids;
+
+  NativeTracer tracer;
+  tracer.onFileOpen([&pids](std::string_view filename, const OpenHandler &h) {
+    if (filename.ends_with(kChildTestFilename))
+      pids.insert(h.pid());
+  });
+  tracer.fork(start);
+  tracer.start();
+  int result = tracer.wait();
+
+  fs::remove(path);
+
+  REQUIRE(result == 0);
+  REQUIRE(pids.size() == 2);
+}
+
+TEST_CASE("can kill applications, that do not exit", "[NativeTracer]") {
+  const auto start = []() {
+    while (true)
+      std::this_thread::sleep_for(10ms);
+  };
+
+  NativeTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  REQUIRE_FALSE(tracer.waitFor(100ms));
+  tracer.kill();
+  REQUIRE(tracer.wait() == SIGKILL);
+}
+
+TEST_CASE("kills background processes, that outlive the application",
+          "[NativeTracer]") {
+  // Children of the test process are not reaped by the tracer.
+  const pid_t unrelated = fork();
+  if (unrelated == 0)
+    _exit(3);
+
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  const auto start = [&fds]() {
+    const pid_t child = fork();
+    if (child == 0) {
+      while (true)
+        std::this_thread::sleep_for(10ms);
+    }
+    (void)write(fds[1], &child, sizeof(child));
+    exit(42);
+  };
+
+  NativeTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  REQUIRE(tracer.waitFor(5s));
+  REQUIRE(tracer.wait() == 42);
+
+  pid_t child = 0;
+  REQUIRE(read(fds[0], &child, sizeof(child)) == sizeof(child));
+  close(fds[0]);
+  close(fds[1]);
+  for (int i = 0; i < 100 && isRunning(child); i++)
+    std::this_thread::sleep_for(10ms);
+  REQUIRE_FALSE(isRunning(child));
+
+  int status = 0;
+  REQUIRE(waitpid(unrelated, &status, 0) == unrelated);
+  REQUIRE(WEXITSTATUS(status) == 3);
+}
+
+TEST_CASE("can interrupt applications", "[NativeTracer]") {
+  const auto start = []() {
+    signal(SIGINT, SIG_DFL);
+    while (true)
+      std::this_thread::sleep_for(10ms);
+  };
+
+  NativeTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  std::this_thread::sleep_for(50ms);
+  tracer.interrupt();
+  REQUIRE(tracer.waitFor(5s));
+  REQUIRE(tracer.wait() == SIGINT);
+}
+
 TEST_CASE("can catch signals", "[NativeTracer]") {
   const auto start = []() {
     std::this_thread::sleep_for(30ms);
+    // Signals are delivered to the tracee, so the signal must not be caught
+    // by the test framework.
+    std::signal(SIGABRT, SIG_DFL);
     std::raise(SIGABRT);
   };
   NativeTracer tracer;
@@ -0,0 +1,90 @@
+#include <catch2/catch.hpp>
+
+#include "utils/RedirectTable.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+
+namespace fs = std::filesystem;
+using namespace dpcpp_trace;
+
+static std::string readFile(const fs::path &path) {
+  std::ifstream is{path, std::ios::binary};
+  return {std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+}
+
+TEST_CASE("redirect table finds paths and libraries", "[redirect]") {
+  const fs::path file = fs::temp_directory_path() / "redirect_table_test";
+
+  RedirectTableBuilder builder;
+  builder.add("/opt/app/bin/app", "/trace/pack/0");
+  builder.add("/usr/lib/libfoo.so.1.2", "/trace/pack/1");
+  builder.add("/usr/lib/libbar.so", "/trace/pack/2");
+  builder.add("/usr/lib/libfoo.sox", "/trace/pack/3");
+  for (int i = 0; i < 100; i++)
+    builder.add("/data/file" + std::to_string(i),
+                "/trace/pack/d" + std::to_string(i));
+  builder.write(file);
+
+  const std::string data = readFile(file);
+  fs::remove(file);
+
+  redirect_table::View view{data.data(), data.size()};
+  REQUIRE(view.valid());
+
+  REQUIRE(std::string{view.findPath("/opt/app/bin/app")} == "/trace/pack/0");
+  REQUIRE(std::string{view.findPath("/data/file42")} == "/trace/pack/d42");
+  REQUIRE(view.findPath("/data/file100") == nullptr);
+  REQUIRE(view.findPath("libbar.so") == nullptr);
+
+  REQUIRE(std::string{view.findLibrary("libfoo.so")} == "/trace/pack/1");
+  REQUIRE(std::string{view.findLibrary("libfoo.so.1")} == "/trace/pack/1");
+  REQUIRE(std::string{view.findLibrary("libfoo.so.1.2")} == "/trace/pack/1");
+  REQUIRE(std::string{view.findLibrary("libbar.so")} == "/trace/pack/2");
+  REQUIRE(view.findLibrary("libfoo.sox") == nullptr);
+  REQUIRE(view.findLibrary("app") == nullptr);
+}
+
+TEST_CASE("redirect table resolves library probes", "[redirect]") {
+  const fs::path file = fs::temp_directory_path() / "redirect_table_probes";
+
+  RedirectTableBuilder builder;
+  builder.add("/usr/lib/libfoo.so.1", "pack/1_libfoo");
+  builder.add("/etc/app.conf", "pack/2_app");
+  builder.write(file);
+
+  const std::string data = readFile(file);
+  fs::remove(file);
+
+  redirect_table::View view{data.data(), data.size()};
+  REQUIRE(view.valid());
+
+  REQUIRE(std::string{view.find("/etc/app.conf")} == "pack/2_app");
+  REQUIRE(view.find("/opt/etc/app.conf") == nullptr);
+  // The loader probes directories from the search path.
+  REQUIRE(std::string{view.find("/missing/dir/libfoo.so.1")} ==
+          "pack/1_libfoo");
+  REQUIRE(std::string{view.find("libfoo.so")} == "pack/1_libfoo");
+  REQUIRE(view.find("/usr/lib/libbaz.so") == nullptr);
+
+  std::map<std::string, std::string> libraries;
+  view.forEachLibrary([&](std::string_view name, const char *replacement) {
+    libraries.emplace(name, replacement);
+  });
+  REQUIRE(libraries == std::map<std::string, std::string>{
+                           {"libfoo.so", "pack/1_libfoo"},
+                           {"libfoo.so.1", "pack/1_libfoo"}});
+}
+
+TEST_CASE("redirect table rejects foreign data", "[redirect]") {
+  const std::string data(64, 'x');
+  redirect_table::View view{data.data(), data.size()};
+  REQUIRE_FALSE(view.valid());
+  REQUIRE(view.findPath("x") == nullptr);
+
+  redirect_table::View empty{data.data(), 4};
+  REQUIRE_FALSE(empty.valid());
+}
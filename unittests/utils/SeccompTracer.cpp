@@ -0,0 +1,407 @@
+#include <catch2/catch.hpp>
+
+#include "utils/Tracer.hpp"
+
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+inline constexpr auto kSeccompForkTestFilename = "seccomp_fork_test";
+inline constexpr auto kSeccompOpenTestFilename = "seccomp_open_test";
+inline constexpr auto kSeccompStatTestFilename = "seccomp_stat_test";
+inline constexpr auto kSeccompReplaceTestFilename1 = "seccomp_replace1_test";
+inline constexpr auto kSeccompReplaceTestFilename2 = "seccomp_replace2_test";
+inline constexpr auto kSeccompPageTestFilename =
+    "seccomp_page_boundary_test";
+inline constexpr auto kSeccompChildTestFilename = "seccomp_child_test";
+inline constexpr auto kSeccompResultTestFilename = "seccomp_result_test";
+
+namespace fs = std::filesystem;
+using namespace dpcpp_trace;
+using namespace std::chrono_literals;
+
+// Killed processes, that were reparented, may stay zombies for a while.
+static bool isSeccompTraceeRunning(pid_t pid) {
+  std::ifstream is{"/proc/" + std::to_string(pid) + "/stat"};
+  std::string stat;
+  std::getline(is, stat);
+  const size_t nameEnd = stat.rfind(')');
+  return nameEnd != std::string::npos && nameEnd + 2 < stat.size() &&
+         stat[nameEnd + 2] != 'Z';
+}
+
+TEST_CASE("seccomp tracer can fork processes", "[SeccompTracer]") {
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    std::ofstream os{fs::temp_directory_path() / kSeccompForkTestFilename};
+    os << 42;
+    os.close();
+  };
+
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  std::ifstream is{fs::temp_directory_path() / kSeccompForkTestFilename};
+  int n;
+  is >> n;
+  is.close();
+  fs::remove(fs::temp_directory_path() / kSeccompForkTestFilename);
+
+  REQUIRE(n == 42);
+}
+
+TEST_CASE("seccomp tracer can trace files being open", "[SeccompTracer]") {
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    std::ofstream os{fs::temp_directory_path() / kSeccompOpenTestFilename};
+    os << 42;
+    os.close();
+  };
+
+  bool test = false;
+
+  SeccompTracer tracer;
+  tracer.onFileOpen([&test](std::string_view filename, const OpenHandler &) {
+    if (filename.ends_with(kSeccompOpenTestFilename))
+      test = true;
+  });
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  std::ifstream is{fs::temp_directory_path() / kSeccompOpenTestFilename};
+  int n;
+  is >> n;
+  is.close();
+  fs::remove(fs::temp_directory_path() / kSeccompOpenTestFilename);
+
+  REQUIRE(test);
+  REQUIRE(n == 42);
+}
+
+TEST_CASE("seccomp tracer can trace files being stat", "[SeccompTracer]") {
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    std::ofstream os{fs::temp_directory_path() / kSeccompStatTestFilename};
+    os << 42;
+    os.close();
+    (void)fs::status(fs::temp_directory_path() / kSeccompStatTestFilename);
+  };
+
+  bool test = false;
+
+  SeccompTracer tracer;
+  tracer.onStat([&test](std::string_view filename, const StatHandler &) {
+    if (filename.ends_with(kSeccompStatTestFilename))
+      test = true;
+  });
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  std::ifstream is{fs::temp_directory_path() / kSeccompStatTestFilename};
+  int n;
+  is >> n;
+  is.close();
+  fs::remove(fs::temp_directory_path() / kSeccompStatTestFilename);
+
+  REQUIRE(test);
+  REQUIRE(n == 42);
+}
+
+TEST_CASE("seccomp tracer can replace filenames", "[SeccompTracer]") {
+  std::ofstream os{fs::temp_directory_path() / kSeccompReplaceTestFilename1};
+  os << 10;
+  os.close();
+
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    std::ofstream os{fs::temp_directory_path() / kSeccompReplaceTestFilename1};
+    os << 42;
+    os.close();
+  };
+
+  SeccompTracer tracer;
+  tracer.onFileOpen([](std::string_view filename, const OpenHandler &h) {
+    if (filename.ends_with(kSeccompReplaceTestFilename1)) {
+      fs::path orig{filename};
+      fs::path repl = orig.parent_path() / kSeccompReplaceTestFilename2;
+      h.replaceFilename(repl.string());
+    }
+  });
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  std::ifstream is1{fs::temp_directory_path() / kSeccompReplaceTestFilename1};
+  int n;
+  is1 >> n;
+  is1.close();
+  fs::remove(fs::temp_directory_path() / kSeccompReplaceTestFilename1);
+
+  REQUIRE(fs::exists(fs::temp_directory_path() / kSeccompReplaceTestFilename2));
+  std::ifstream is2{fs::temp_directory_path() / kSeccompReplaceTestFilename2};
+  int k;
+  is2 >> k;
+  is2.close();
+  fs::remove(fs::temp_directory_path() / kSeccompReplaceTestFilename2);
+
+  REQUIRE(k == 42);
+  REQUIRE(n == 10);
+}
+
+TEST_CASE("seccomp tracer can replace filenames of stat calls",
+          "[SeccompTracer]") {
+  const fs::path tmp = fs::temp_directory_path();
+  const fs::path orig = tmp / kSeccompReplaceTestFilename1;
+  const fs::path repl = tmp / kSeccompReplaceTestFilename2;
+  std::ofstream{repl} << 42;
+
+  const auto start = [orig]() {
+    std::this_thread::sleep_for(30ms);
+    exit(fs::file_size(orig) == 2 ? 0 : 1);
+  };
+
+  SeccompTracer tracer;
+  tracer.onStat([repl](std::string_view filename, const StatHandler &h) {
+    if (filename.ends_with(kSeccompReplaceTestFilename1))
+      h.replaceFilename(repl.string());
+  });
+  tracer.fork(start);
+  tracer.start();
+  int result = tracer.wait();
+
+  fs::remove(repl);
+
+  REQUIRE(result == 0);
+}
+
+TEST_CASE("seccomp tracer can read filenames at the end of a page",
+          "[SeccompTracer]") {
+  const std::string path =
+      (fs::temp_directory_path() / kSeccompPageTestFilename).string();
+
+  const auto start = [&path]() {
+    std::this_thread::sleep_for(30ms);
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    auto *mem = static_cast<char *>(mmap(nullptr, 2 * pageSize,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    munmap(mem + pageSize, pageSize);
+
+    // The terminating zero is the last byte before the unmapped page.
+    char *str = mem + pageSize - path.size() - 1;
+    std::memcpy(str, path.c_str(), path.size() + 1);
+    const int fd = open(str, O_WRONLY | O_CREAT, 0644);
+    if (fd != -1)
+      close(fd);
+  };
+
+  std::string traced;
+
+  SeccompTracer tracer;
+  tracer.onFileOpen([&traced](std::string_view filename, const OpenHandler &) {
+    if (filename.ends_with(kSeccompPageTestFilename))
+      traced = filename;
+  });
+  tracer.fork(start);
+  tracer.start();
+  tracer.wait();
+
+  fs::remove(path);
+
+  REQUIRE(traced == path);
+}
+
+TEST_CASE("seccomp tracer reports results of redirected opens only",
+          "[SeccompTracer]") {
+  const fs::path file = fs::temp_directory_path() / kSeccompResultTestFilename;
+  std::ofstream{file} << 42;
+
+  // The last open is not redirected, so it is made by the tracee.
+  const auto start = [file]() {
+    const int fd = open((file.string() + "_redirected").c_str(),
+                        O_RDONLY | O_CLOEXEC);
+    char c = 0;
+    const bool hasData = fd != -1 && read(fd, &c, 1) == 1 && c == '4';
+    open((file.string() + "_missing").c_str(), O_RDONLY);
+    const bool hasFile = open(file.c_str(), O_RDONLY) != -1;
+    exit(hasData && hasFile ? 0 : 1);
+  };
+
+  long existing = 0;
+  long missing = 0;
+  bool continuedReported = false;
+  int flags = 0;
+
+  SeccompTracer tracer;
+  tracer.onFileOpen([&](std::string_view filename, const OpenHandler &h) {
+    if (filename == file.string() + "_redirected") {
+      flags = h.flags();
+      h.replaceFilename(file.string());
+      h.onReturn([&](long result) { existing = result; });
+    } else if (filename == file.string() + "_missing") {
+      h.replaceFilename(file.string() + "_missing_too");
+      h.onReturn([&](long result) { missing = result; });
+    } else if (filename == file.string()) {
+      h.onReturn([&](long) { continuedReported = true; });
+    }
+  });
+  tracer.fork(start);
+  tracer.start();
+  const int code = tracer.wait();
+  fs::remove(file);
+
+  REQUIRE(code == 0);
+  REQUIRE(existing >= 0);
+  REQUIRE(missing == -ENOENT);
+  REQUIRE_FALSE(continuedReported);
+  REQUIRE((flags & O_CLOEXEC) == O_CLOEXEC);
+}
+
+TEST_CASE("seccomp tracer does not profile I/O", "[SeccompTracer]") {
+  SeccompTracer tracer;
+  REQUIRE_THROWS_AS(tracer.onIO([](const IOHandler &) {}),
+                    std::runtime_error);
+}
+
+TEST_CASE("seccomp tracer can trace child processes and threads",
+          "[SeccompTracer]") {
+  const fs::path path = fs::temp_directory_path() / kSeccompChildTestFilename;
+  std::ofstream{path} << 42;
+
+  const auto start = [&path]() {
+    std::this_thread::sleep_for(30ms);
+    std::thread thread{[&path] { std::ifstream{path}; }};
+    thread.join();
+
+    const pid_t child = fork();
+    if (child == 0) {
+      const int devNull = open("/dev/null", O_WRONLY);
+      dup2(devNull, STDOUT_FILENO);
+      execl("/bin/cat", "cat", path.c_str(), nullptr);
+      _exit(1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+  };
+
+  std::set<int> pids;
+
+  SeccompTracer tracer;
+  tracer.onFileOpen([&pids](std::string_view filename, const OpenHandler &h) {
+    if (filename.ends_with(kSeccompChildTestFilename))
+      pids.insert(h.pid());
+  });
+  tracer.fork(start);
+  tracer.start();
+  int result = tracer.wait();
+
+  fs::remove(path);
+
+  REQUIRE(result == 0);
+  REQUIRE(pids.size() == 2);
+}
+
+TEST_CASE("seccomp tracer can kill applications, that do not exit", "[SeccompTracer]") {
+  const auto start = []() {
+    while (true)
+      std::this_thread::sleep_for(10ms);
+  };
+
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  REQUIRE_FALSE(tracer.waitFor(100ms));
+  tracer.kill();
+  REQUIRE(tracer.wait() == SIGKILL);
+}
+
+TEST_CASE("seccomp tracer kills background processes, that outlive the "
+          "application",
+          "[SeccompTracer]") {
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  const auto start = [&fds]() {
+    const pid_t child = fork();
+    if (child == 0) {
+      while (true)
+        std::this_thread::sleep_for(10ms);
+    }
+    (void)write(fds[1], &child, sizeof(child));
+    exit(42);
+  };
+
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  REQUIRE(tracer.waitFor(5s));
+  REQUIRE(tracer.wait() == 42);
+
+  pid_t child = 0;
+  REQUIRE(read(fds[0], &child, sizeof(child)) == sizeof(child));
+  close(fds[0]);
+  close(fds[1]);
+  for (int i = 0; i < 100 && isSeccompTraceeRunning(child); i++)
+    std::this_thread::sleep_for(10ms);
+  REQUIRE_FALSE(isSeccompTraceeRunning(child));
+}
+
+TEST_CASE("seccomp tracer can interrupt applications", "[SeccompTracer]") {
+  const auto start = []() {
+    signal(SIGINT, SIG_DFL);
+    while (true)
+      std::this_thread::sleep_for(10ms);
+  };
+
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  std::this_thread::sleep_for(50ms);
+  tracer.interrupt();
+  REQUIRE(tracer.waitFor(5s));
+  REQUIRE(tracer.wait() == SIGINT);
+}
+
+TEST_CASE("seccomp tracer can catch signals", "[SeccompTracer]") {
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    // The tracee is not stopped by the tracer, so the signal must not be
+    // caught by the test framework.
+    std::signal(SIGABRT, SIG_DFL);
+    std::raise(SIGABRT);
+  };
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  int result = tracer.wait();
+
+  REQUIRE(result != 0);
+}
+
+TEST_CASE("seccomp tracer can capture exit code", "[SeccompTracer]") {
+  const auto start = []() {
+    std::this_thread::sleep_for(30ms);
+    exit(42);
+  };
+  SeccompTracer tracer;
+  tracer.fork(start);
+  tracer.start();
+  int result = tracer.wait();
+
+  REQUIRE(result == 42);
+}
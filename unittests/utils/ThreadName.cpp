@@ -0,0 +1,93 @@
+#include <catch2/catch.hpp>
+
+#include "constants.hpp"
+#include "thread_name.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// libsystem_intercept is linked into the tests, so threads, that the tests
+// create, are named by it.
+extern "C" void dpcppTraceSetInternalThreadCreation(bool value);
+
+using namespace dpcpp_trace;
+
+// Names of threads, that are created by the calling thread.
+static std::string nameOfNewThread() {
+  std::string name;
+  std::thread{[&name] { name = getThreadName(); }}.join();
+  return name;
+}
+
+TEST_CASE("threads are named after their parents", "[thread_name]") {
+  std::string parent;
+  std::string first;
+  std::string second;
+  std::string nested;
+  std::thread{[&] {
+    parent = getThreadName();
+    first = nameOfNewThread();
+    std::thread{[&] {
+      second = getThreadName();
+      nested = nameOfNewThread();
+    }}.join();
+  }}.join();
+
+  REQUIRE(parent.starts_with("main_"));
+  REQUIRE(first == parent + "_0");
+  REQUIRE(second == parent + "_1");
+  REQUIRE(nested == parent + "_1_0");
+}
+
+TEST_CASE("internal threads do not affect names", "[thread_name]") {
+  std::string parent;
+  std::string internal;
+  std::string next;
+  std::thread{[&] {
+    parent = getThreadName();
+    dpcppTraceSetInternalThreadCreation(true);
+    internal = nameOfNewThread();
+    dpcppTraceSetInternalThreadCreation(false);
+    next = nameOfNewThread();
+  }}.join();
+
+  REQUIRE(!internal.starts_with(parent + "_"));
+  REQUIRE(next == parent + "_0");
+}
+
+TEST_CASE("forked processes are named after the forking thread",
+          "[thread_name]") {
+  std::string parent;
+  int firstStatus = -1;
+  int secondStatus = -1;
+  std::thread{[&] {
+    parent = getThreadName();
+    // Exit codes tell, if names in the child are as expected.
+    const auto forkAndCheck = [&parent](const std::string &expected) {
+      const pid_t child = fork();
+      if (child == 0) {
+        // The name is kept, if the child executes another program.
+        const char *exported = std::getenv(kProcessNameEnvVar);
+        const bool named =
+            getThreadName() == expected &&
+            nameOfNewThread() == expected + "_0" && exported &&
+            exported == std::to_string(getpid()) + " " + expected;
+        _exit(named ? 0 : 1);
+      }
+      int status = -1;
+      waitpid(child, &status, 0);
+      return status;
+    };
+    firstStatus = forkAndCheck(parent + "_f0");
+    secondStatus = forkAndCheck(parent + "_f1");
+  }}.join();
+
+  REQUIRE(WIFEXITED(firstStatus));
+  REQUIRE(WEXITSTATUS(firstStatus) == 0);
+  REQUIRE(WIFEXITED(secondStatus));
+  REQUIRE(WEXITSTATUS(secondStatus) == 0);
+  REQUIRE(getThreadName() == "main");
+}
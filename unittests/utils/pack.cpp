@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+#include <stdexcept>
+
+#include "options.hpp"
+
+TEST_CASE("pack options are handled correctly", "[pack]") {
+  std::array<const char *, 1> env = {nullptr};
+  SECTION("has defaults") {
+    std::array<const char *, 3> testArgs = {"prog", "pack", "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.input().string() == "trace");
+      REQUIRE(opts.jobs() == 0);
+      REQUIRE(opts.compression_level() == kDefaultCompressionLevel);
+      REQUIRE_FALSE(opts.pack_dictionary());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has jobs and level") {
+    std::array<const char *, 9> testArgs = {
+        "prog", "pack", "trace", "-o", "out.pack", "-j", "8", "--level", "19"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.output().string() == "out.pack");
+      REQUIRE(opts.jobs() == 8);
+      REQUIRE(opts.compression_level() == 19);
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has dictionary") {
+    std::array<const char *, 4> testArgs = {"prog", "pack", "trace",
+                                            "--dictionary"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.pack_dictionary());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has base") {
+    std::array<const char *, 7> testArgs = {
+        "prog", "pack", "trace", "-o", "new.pack", "--base", "old.pack"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.pack_base().string() == "old.pack");
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has invalid level") {
+    std::array<const char *, 5> testArgs = {"prog", "pack", "trace", "--level",
+                                            "42"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+  SECTION("has invalid jobs") {
+    std::array<const char *, 5> testArgs = {"prog", "pack", "trace", "-j",
+                                            "0"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+}
+
+TEST_CASE("unpack options are handled correctly", "[pack]") {
+  std::array<const char *, 1> env = {nullptr};
+  SECTION("has filters") {
+    std::array<const char *, 9> testArgs = {
+        "prog",   "unpack", "trace.pack", "-o",
+        "trace",  "--only", "pack/*",     "--only",
+        "buffers/main_*"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.input().string() == "trace.pack");
+      REQUIRE(opts.unpack_only().size() == 2);
+      REQUIRE(opts.unpack_only()[0] == "pack/*");
+      REQUIRE(opts.unpack_only()[1] == "buffers/main_*");
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has jobs") {
+    std::array<const char *, 5> testArgs = {"prog", "unpack", "trace.pack",
+                                            "-j", "4"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.jobs() == 4);
+      REQUIRE(opts.unpack_only().empty());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has missing filter") {
+    std::array<const char *, 4> testArgs = {"prog", "unpack", "trace.pack",
+                                            "--only"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+}
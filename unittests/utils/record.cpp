@@ -80,6 +80,56 @@ TEST_CASE("optional arguments are handled correctly", "[record]") {
     };
     REQUIRE_THROWS_AS(run(), std::runtime_error);
   }
+  SECTION("has --elide-info-queries") {
+    std::array<const char *, 6> testArgs = {
+        "prog", "record", "-o", "test", "--elide-info-queries", "input"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.record_elide_info_queries());
+      REQUIRE_FALSE(opts.record_skip_mem_objects());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has --io-profile") {
+    std::array<const char *, 6> testArgs = {"prog", "record",       "-o",
+                                            "test", "--io-profile", "input"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.record_io_profile());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has --io-profile with seccomp tracer") {
+    std::array<const char *, 8> testArgs = {
+        "prog",  "record",  "-o",           "test", "--tracer",
+        "seccomp", "--io-profile", "input"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+  SECTION("has --timeout") {
+    std::array<const char *, 7> testArgs = {"prog", "record", "-o",   "test",
+                                            "--timeout", "5",  "input"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.timeout() == std::chrono::seconds{5});
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has invalid --timeout") {
+    std::array<const char *, 7> testArgs = {"prog", "record", "-o",   "test",
+                                            "--timeout", "0",  "input"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
   SECTION("has extra args") {
     std::array<const char *, 8> testArgs = {
         "prog", "record", "-o", "test", "input", "--", "--foo", "--bar"};
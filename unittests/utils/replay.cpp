@@ -0,0 +1,117 @@
+#include <catch2/catch.hpp>
+#include <stdexcept>
+
+#include "options.hpp"
+
+TEST_CASE("replay bench options are handled correctly", "[replay]") {
+  std::array<const char *, 1> env = {nullptr};
+  SECTION("has --bench") {
+    std::array<const char *, 4> testArgs = {"prog", "replay", "--bench",
+                                            "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.input().string() == "trace");
+      REQUIRE(opts.replay_bench());
+      REQUIRE(opts.replay_bench_iterations() == 1);
+      REQUIRE(opts.replay_bench_output().empty());
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has iterations and output") {
+    std::array<const char *, 8> testArgs = {
+        "prog", "replay", "--bench",        "-n",
+        "10",   "trace",  "--bench-output", "out.json"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+      REQUIRE(opts.replay_bench_iterations() == 10);
+      REQUIRE(opts.replay_bench_output().string() == "out.json");
+    };
+    REQUIRE_NOTHROW(run());
+  }
+  SECTION("has invalid iterations") {
+    std::array<const char *, 6> testArgs = {"prog", "replay", "--bench",
+                                            "-n",   "zero",   "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+  SECTION("has iterations without --bench") {
+    std::array<const char *, 5> testArgs = {"prog", "replay", "-n", "10",
+                                            "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+  SECTION("has output without --bench") {
+    std::array<const char *, 5> testArgs = {"prog", "replay", "--bench-output",
+                                            "out.json", "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+  SECTION("has --bench and --print-only") {
+    std::array<const char *, 5> testArgs = {"prog", "replay", "--bench", "-p",
+                                            "trace"};
+    const auto run = [&]() {
+      options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                   const_cast<char **>(env.data())};
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+  }
+}
+
+TEST_CASE("replay accepts --tolerant", "[replay]") {
+  std::array<const char *, 1> env = {nullptr};
+  std::array<const char *, 4> testArgs = {"prog", "replay", "--tolerant",
+                                          "trace"};
+  const auto run = [&]() {
+    options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                 const_cast<char **>(env.data())};
+    REQUIRE(opts.replay_tolerant());
+    REQUIRE_FALSE(opts.replay_bench());
+  };
+  REQUIRE_NOTHROW(run());
+}
+
+TEST_CASE("replay accepts --cache-size", "[replay]") {
+  std::array<const char *, 1> env = {nullptr};
+  std::array<const char *, 5> testArgs = {"prog", "replay", "--cache-size",
+                                          "16", "trace.pack"};
+  const auto run = [&]() {
+    options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                 const_cast<char **>(env.data())};
+    REQUIRE(opts.replay_cache_size() == 16 * 1024 * 1024);
+  };
+  REQUIRE_NOTHROW(run());
+}
+
+TEST_CASE("replay accepts --timeout", "[replay]") {
+  std::array<const char *, 1> env = {nullptr};
+  std::array<const char *, 5> testArgs = {"prog", "replay", "--timeout", "30",
+                                          "trace"};
+  const auto run = [&]() {
+    options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                 const_cast<char **>(env.data())};
+    REQUIRE(opts.timeout() == std::chrono::seconds{30});
+  };
+  REQUIRE_NOTHROW(run());
+}
+
+TEST_CASE("debug rejects --timeout", "[replay]") {
+  std::array<const char *, 1> env = {nullptr};
+  std::array<const char *, 5> testArgs = {"prog", "debug", "--timeout", "30",
+                                          "trace"};
+  const auto run = [&]() {
+    options opts{testArgs.size(), const_cast<char **>(testArgs.data()),
+                 const_cast<char **>(env.data())};
+  };
+  REQUIRE_THROWS_AS(run(), std::runtime_error);
+}
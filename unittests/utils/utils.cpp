@@ -3,7 +3,10 @@
 
 #include "utils.hpp"
 
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <string>
 
 TEST_CASE("which finds full path to executable", "[utils]") {
   std::string fullPath = "";
@@ -11,3 +14,26 @@ TEST_CASE("which finds full path to executable", "[utils]") {
 
   REQUIRE(fullPath.ends_with("ls"));
 }
+
+TEST_CASE("copyFile copies contents", "[utils]") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "dpcpp_trace_copy_test";
+  fs::create_directories(dir);
+
+  std::string contents;
+  for (int i = 0; i < 100000; i++)
+    contents += std::to_string(i);
+  {
+    std::ofstream os{dir / "from", std::ios::binary};
+    os << contents;
+  }
+
+  REQUIRE_NOTHROW(copyFile(dir / "from", dir / "to"));
+  std::ifstream is{dir / "to", std::ios::binary};
+  std::string copied{std::istreambuf_iterator<char>{is}, {}};
+  REQUIRE(copied == contents);
+
+  REQUIRE_THROWS_AS(copyFile(dir / "missing", dir / "to"), std::runtime_error);
+
+  fs::remove_all(dir);
+}